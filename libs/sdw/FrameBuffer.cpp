@@ -0,0 +1,127 @@
+#include <array>
+#include <algorithm>
+#include "FrameBuffer.h"
+
+FrameBuffer::FrameBuffer() : width(0), height(0) {}
+
+FrameBuffer::FrameBuffer(int w, int h) : width(w), height(h), pixelBuffer(w * h) {}
+
+void FrameBuffer::savePPM(const std::string &filename) const {
+	std::ofstream outputStream(filename, std::ofstream::out);
+	outputStream << "P6\n";
+	outputStream << width << " " << height << "\n";
+	outputStream << "255\n";
+
+	for (size_t i = 0; i < width * height; i++) {
+		std::array<char, 3> rgb {{
+				static_cast<char> ((pixelBuffer[i] >> 16) & 0xFF),
+				static_cast<char> ((pixelBuffer[i] >> 8) & 0xFF),
+				static_cast<char> ((pixelBuffer[i] >> 0) & 0xFF)
+		}};
+		outputStream.write(rgb.data(), 3);
+	}
+	outputStream.close();
+}
+
+namespace {
+	void putBigEndian(std::vector<uint8_t> &bytes, uint32_t value) {
+		for (int shift = 24; shift >= 0; shift -= 8) bytes.push_back((value >> shift) & 0xFF);
+	}
+
+	uint32_t crc32(const uint8_t *bytes, size_t length) {
+		static uint32_t table[256];
+		static bool filled = false;
+		if (!filled) {
+			for (uint32_t n = 0; n < 256; n++) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				table[n] = c;
+			}
+			filled = true;
+		}
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < length; i++) crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+	// appends a chunk (length, type, data and the crc of type and data) to a png file's bytes
+	void putChunk(std::vector<uint8_t> &png, const char *type, const std::vector<uint8_t> &data) {
+		putBigEndian(png, data.size());
+		size_t start = png.size();
+		png.insert(png.end(), type, type + 4);
+		png.insert(png.end(), data.begin(), data.end());
+		putBigEndian(png, crc32(&png[start], png.size() - start));
+	}
+}
+
+// Written without compression (zlib "stored" blocks), so no zlib is needed, files come out about the size of a .ppm
+void FrameBuffer::savePNG(const std::string &filename) const {
+	// every row starts with filter type 0 (none), then RGB bytes
+	std::vector<uint8_t> raw;
+	raw.reserve(height * (width * 3 + 1));
+	for (size_t y = 0; y < height; y++) {
+		raw.push_back(0);
+		for (size_t x = 0; x < width; x++) {
+			uint32_t pixel = pixelBuffer[y * width + x];
+			raw.push_back((pixel >> 16) & 0xFF);
+			raw.push_back((pixel >> 8) & 0xFF);
+			raw.push_back(pixel & 0xFF);
+		}
+	}
+
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	const size_t maxBlock = 65535;
+	for (size_t start = 0;; start += maxBlock) {
+		size_t length = std::min(maxBlock, raw.size() - start);
+		bool last = start + length >= raw.size();
+		zlib.push_back(last ? 1 : 0);
+		zlib.push_back(length & 0xFF);
+		zlib.push_back(length >> 8);
+		zlib.push_back(~length & 0xFF);
+		zlib.push_back((~length >> 8) & 0xFF);
+		zlib.insert(zlib.end(), raw.begin() + start, raw.begin() + start + length);
+		if (last) break;
+	}
+	uint32_t a = 1, b = 0;
+	for (uint8_t byte : raw) {
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	putBigEndian(zlib, (b << 16) | a);
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<uint8_t> header;
+	putBigEndian(header, width);
+	putBigEndian(header, height);
+	// 8 bits per channel, colour type 2 (RGB), default compression, filtering and no interlacing
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });
+	putChunk(png, "IHDR", header);
+	putChunk(png, "IDAT", zlib);
+	putChunk(png, "IEND", {});
+
+	std::ofstream outputStream(filename, std::ofstream::out | std::ofstream::binary);
+	outputStream.write(reinterpret_cast<const char *>(png.data()), png.size());
+	outputStream.close();
+}
+
+void FrameBuffer::setPixelColour(size_t x, size_t y, uint32_t colour) {
+	if ((x >= width) || (y >= height)) {
+		std::cout << x << "," << y << " not on visible screen area" << std::endl;
+	} else pixelBuffer[(y * width) + x] = colour;
+}
+
+uint32_t FrameBuffer::getPixelColour(size_t x, size_t y) {
+	if ((x >= width) || (y >= height)) {
+		std::cout << x << "," << y << " not on visible screen area" << std::endl;
+		return -1;
+	} else return pixelBuffer[(y * width) + x];
+}
+
+// row-major, pixel (x, y) is at y * width + x
+uint32_t *FrameBuffer::getPixelBuffer() {
+	return pixelBuffer.data();
+}
+
+void FrameBuffer::clearPixels() {
+	std::fill(pixelBuffer.begin(), pixelBuffer.end(), 0);
+}
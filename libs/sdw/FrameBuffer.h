@@ -0,0 +1,28 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+
+// Off-screen image the renderers draw into, pixels are 0xAARRGGBB.
+// DrawingWindow is one of these that can also be shown on screen, a plain FrameBuffer needs no display (or SDL) at all.
+class FrameBuffer {
+
+public:
+	size_t width;
+	size_t height;
+
+protected:
+	std::vector<uint32_t> pixelBuffer;
+
+public:
+	FrameBuffer();
+	FrameBuffer(int w, int h);
+	void savePPM(const std::string &filename) const;
+	void savePNG(const std::string &filename) const;
+	void setPixelColour(size_t x, size_t y, uint32_t colour);
+	uint32_t getPixelColour(size_t x, size_t y);
+	uint32_t *getPixelBuffer();
+	void clearPixels();
+};
@@ -14,3 +14,17 @@ std::vector<std::string> split(const std::string &line, char delimiter) {
 	tokens.push_back(haystack);
 	return tokens;
 }
+
+// "1920x1080" to a width and height, false (leaving them alone) unless it is two positive whole numbers
+bool parseResolution(const std::string &text, int &width, int &height) {
+	std::vector<std::string> parts = split(text, 'x');
+	if (parts.size() != 2) return false;
+	std::istringstream widthStream(parts[0]), heightStream(parts[1]);
+	int w, h;
+	char extra;
+	if (!(widthStream >> w) || widthStream >> extra || !(heightStream >> h) || heightStream >> extra) return false;
+	if (w <= 0 || h <= 0) return false;
+	width = w;
+	height = h;
+	return true;
+}
@@ -4,3 +4,5 @@
 #include <vector>
 
 std::vector<std::string> split(const std::string &line, char delimiter);
+
+bool parseResolution(const std::string &text, int &width, int &height);
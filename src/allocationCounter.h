@@ -0,0 +1,27 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// In debug builds every heap allocation goes through here and is counted,
+// so the render loops can check they don't allocate anything per pixel
+#ifndef NDEBUG
+std::atomic<size_t> allocationCount(0);
+
+// new and delete are kept out of line, or GCC sees malloc and free under them and warns that they don't match
+// what the other side calls (-Wmismatched-new-delete)
+[[gnu::noinline]] void* operator new(size_t size) {
+	allocationCount++;
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == nullptr) throw std::bad_alloc();
+	return p;
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+	free(p);
+}
+
+// the sized form the compiler may call instead, so every deallocation goes through the one above
+void operator delete(void* p, size_t) noexcept {
+	::operator delete(p);
+}
+#endif
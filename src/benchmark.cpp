@@ -0,0 +1,215 @@
+#include <renderer.h>
+#include <chrono>
+#include <sstream>
+#include <numeric>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+// Renders the same camera path over the logo and Cornell box scenes in every render mode (and every lighting mode of
+// the ray tracer) and reports how long frames took, as JSON so runs can be compared against each other over time.
+// Scenes are loaded from the working directory like the other programs, a scene that is not there is skipped.
+// Run with --help for the options.
+
+const char* usage =
+	"usage: benchmark [options]\n"
+	"  --frames N         frames per run, spread evenly along the camera path, default 24\n"
+	"  --scene NAME       only benchmark this scene (logo or cornell)\n"
+	"  --mode MODE        only benchmark this render mode (wireframe, raster or raytrace)\n"
+	"  --size WxH         image size, default 640x480 (showing the same view at any size)\n"
+	"  --output FILE      write the JSON report here instead of to standard output\n"
+	"  --threads N        cores to use, default all of them\n";
+
+const char* modeNames[] = { "wireframe", "raster", "raytrace" };
+
+struct BenchmarkScene {
+	string name;
+	string objFile;
+	string mtlFile;
+	float scalingFactor;
+	Mesh (*loader)(string, float, const MaterialTable&);
+	vec3 light;
+};
+
+struct CameraPose {
+	vec3 position;
+	mat3 orientation;
+};
+
+// The logo animation from start to end, then frames poses spread evenly along it (all of them if there are fewer)
+vector<CameraPose> cameraPath(int frames) {
+	vector<CameraPose> path;
+	CameraPose pose = { vec3(0, 0.25, 4.0), mat3(1.0) };
+	int move = 1;
+	while ((move = stepLogoAnimation(pose.position, pose.orientation, move)) != 0) path.push_back(pose);
+	if ((int)path.size() <= frames) return path;
+	vector<CameraPose> sampled;
+	for (int i = 0; i < frames; i++) sampled.push_back(path[(size_t)i * (path.size() - 1) / std::max(frames - 1, 1)]);
+	return sampled;
+}
+
+// largest resident set the process has had, in KiB (0 where getrusage is not available)
+long peakResidentKiB() {
+#ifndef _WIN32
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+		return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+		return usage.ru_maxrss;
+#endif
+	}
+#endif
+	return 0;
+}
+
+// text to a count, false unless all of it is a whole number above 0
+bool parseCount(const string& text, int& result) {
+	istringstream stream(text);
+	int value;
+	char extra;
+	if (!(stream >> value) || stream >> extra || value <= 0) return false;
+	result = value;
+	return true;
+}
+
+// value at or below which p percent of the (sorted) times fall, nearest rank
+double percentile(const vector<double>& sorted, double p) {
+	size_t rank = (size_t)std::ceil(p / 100 * sorted.size());
+	return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+struct RunResult {
+	string scene;
+	string mode;
+	int lightingMode;
+	vector<double> frameMilliseconds;
+	uint64_t rays;
+	uint64_t triangles;
+};
+
+// renders every pose of path once (after one untimed frame to warm caches and buffers up)
+RunResult benchmarkRun(FrameBuffer& frame, DepthBuffer& depthBuffer, const Scene& scene, const BenchmarkScene& setup, int renderMode, int lightingMode, const vector<CameraPose>& path) {
+	RunResult result;
+	result.scene = setup.name;
+	result.mode = modeNames[renderMode];
+	result.lightingMode = lightingMode;
+	float focalLength = 2;
+	float scaleFactor = scaleForWidth(1500, frame.width);
+	auto render = [&](const CameraPose& pose) {
+		if (renderMode == 0) renderWireFrame(frame, scene, pose.position, focalLength, scaleFactor, pose.orientation);
+		if (renderMode == 1) renderRasterizedScene(frame, depthBuffer, scene, pose.position, focalLength, scaleFactor, pose.orientation);
+		if (renderMode == 2) renderRayTracedScene(frame, scene, pose.position, pose.orientation, setup.light, lightingMode, focalLength, scaleFactor);
+	};
+
+	render(path[0]);
+	uint64_t raysBefore = totalRaysCast();
+	for (const CameraPose& pose : path) {
+		auto start = chrono::steady_clock::now();
+		render(pose);
+		result.frameMilliseconds.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+	result.rays = totalRaysCast() - raysBefore;
+	result.triangles = renderMode == 2 ? 0 : (uint64_t)scene.mesh.triangleCount() * path.size();
+	return result;
+}
+
+void writeRun(ostream& out, const RunResult& run) {
+	vector<double> sorted = run.frameMilliseconds;
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0;
+	for (double milliseconds : sorted) total += milliseconds;
+	double seconds = total / 1000;
+	out << "    {\"scene\": \"" << run.scene << "\", \"mode\": \"" << run.mode << "\"";
+	if (run.mode == "raytrace") out << ", \"lightingMode\": " << run.lightingMode;
+	out << ", \"frames\": " << sorted.size()
+		<< ", \"totalMs\": " << total
+		<< ", \"meanMs\": " << total / sorted.size()
+		<< ", \"minMs\": " << sorted.front()
+		<< ", \"p50Ms\": " << percentile(sorted, 50)
+		<< ", \"p90Ms\": " << percentile(sorted, 90)
+		<< ", \"p99Ms\": " << percentile(sorted, 99)
+		<< ", \"maxMs\": " << sorted.back();
+	if (run.mode == "raytrace") out << ", \"rays\": " << run.rays << ", \"raysPerSecond\": " << run.rays / seconds;
+	else out << ", \"triangles\": " << run.triangles << ", \"trianglesPerSecond\": " << run.triangles / seconds;
+	out << "}";
+}
+
+int main(int argc, char* argv[]) {
+	int frames = 24;
+	string onlyScene;
+	string onlyMode;
+	string output;
+	int width = DEFAULT_WIDTH;
+	int height = DEFAULT_HEIGHT;
+	for (int i = 1; i < argc; i++) {
+		string option = argv[i];
+		bool ok = i + 1 < argc;
+		if (option == "--help" || option == "-h") {
+			cout << usage;
+			return 0;
+		}
+		else if (ok && option == "--frames") ok = parseCount(argv[++i], frames);
+		else if (ok && option == "--scene") onlyScene = argv[++i];
+		else if (ok && option == "--mode") onlyMode = argv[++i];
+		else if (ok && option == "--output") output = argv[++i];
+		else if (ok && option == "--size") ok = parseResolution(argv[++i], width, height);
+		else if (ok && option == "--threads") {
+			int threads;
+			ok = parseCount(argv[++i], threads);
+			if (ok) threadPool.resize(threads);
+		}
+		else ok = false;
+		if (!ok) {
+			cout << "bad option " << option << "\n" << usage;
+			return 1;
+		}
+	}
+
+	vector<BenchmarkScene> scenes = {
+		{ "logo", "logo.obj", "materials.mtl", 0.001, unloadTextureFile, vec3(0.0, 0.0, 1.0) },
+		{ "cornell", "new-cornell-box.obj", "new-cornell-box.mtl", 0.17, unloadNewFile, vec3(0.0, 0.4, 0.2) },
+	};
+	vector<CameraPose> path = cameraPath(frames);
+	FrameBuffer frame(width, height);
+	DepthBuffer depthBuffer;
+	vector<RunResult> runs;
+	vector<string> skipped;
+
+	for (const BenchmarkScene& setup : scenes) {
+		if (!onlyScene.empty() && setup.name != onlyScene) continue;
+		if (!ifstream(setup.objFile)) {
+			skipped.push_back(setup.name + ": could not open " + setup.objFile);
+			continue;
+		}
+		const Scene scene = loadCachedScene(setup.objFile, setup.mtlFile, setup.scalingFactor, setup.loader);
+		for (int renderMode = 0; renderMode < 3; renderMode++) {
+			if (!onlyMode.empty() && onlyMode != modeNames[renderMode]) continue;
+			// the lighting mode only changes what the ray tracer does
+			int lightingModes = renderMode == 2 ? 6 : 1;
+			for (int lightingMode = 0; lightingMode < lightingModes; lightingMode++) {
+				RunResult run = benchmarkRun(frame, depthBuffer, scene, setup, renderMode, lightingMode, path);
+				runs.push_back(run);
+				cerr << run.scene << " " << run.mode << (renderMode == 2 ? " lighting " + to_string(lightingMode) : "") << ": "
+					<< std::accumulate(run.frameMilliseconds.begin(), run.frameMilliseconds.end(), 0.0) / run.frameMilliseconds.size() << " ms/frame" << endl;
+			}
+		}
+	}
+
+	stringstream json;
+	json << "{\n  \"width\": " << width << ", \"height\": " << height << ", \"threads\": " << threadPool.size()
+		<< ", \"framesPerRun\": " << path.size() << ",\n  \"peakRssKiB\": " << peakResidentKiB() << ",\n  \"skipped\": [";
+	for (size_t i = 0; i < skipped.size(); i++) json << (i ? ", " : "") << "\"" << skipped[i] << "\"";
+	json << "],\n  \"runs\": [\n";
+	for (size_t i = 0; i < runs.size(); i++) {
+		writeRun(json, runs[i]);
+		json << (i + 1 < runs.size() ? ",\n" : "\n");
+	}
+	json << "  ]\n}\n";
+
+	if (output.empty()) cout << json.str();
+	else ofstream(output) << json.str();
+}
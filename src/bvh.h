@@ -0,0 +1,176 @@
+using namespace std;
+using namespace glm;
+
+// axis aligned bounding box, starts out empty so the first grow sets it
+struct AABB {
+	vec3 minimum = vec3(numeric_limits<float>::max());
+	vec3 maximum = vec3(-numeric_limits<float>::max());
+
+	void grow(vec3 point) {
+		minimum = glm::min(minimum, point);
+		maximum = glm::max(maximum, point);
+	}
+
+	void grow(const AABB& box) {
+		minimum = glm::min(minimum, box.minimum);
+		maximum = glm::max(maximum, box.maximum);
+	}
+
+	// half the surface area, only ever compared against other areas so the factor of 2 is dropped
+	float area() const {
+		vec3 extent = maximum - minimum;
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+};
+
+// children of a node are stored next to each other, so leftFirst is either the left child (right is leftFirst + 1)
+// or, for a leaf (count > 0), the first entry in triangleIndices
+struct BVHNode {
+	AABB bounds;
+	int leftFirst = 0;
+	int count = 0;
+};
+
+struct BVH {
+	vector<BVHNode> nodes;
+	vector<int> triangleIndices;
+};
+
+#define BVH_BINS 12
+#define BVH_MAX_DEPTH 60
+
+// 1 / direction, with components that are (nearly) zero clamped to a huge finite value instead of infinity
+// so box tests never multiply 0 by infinity, which keeps the scalar and packet tests giving the same answers
+vec3 safeInverse(vec3 direction) {
+	vec3 inverse;
+	for (int axis = 0; axis < 3; axis++) {
+		if (std::abs(direction[axis]) > 1e-20f) inverse[axis] = 1.0f / direction[axis];
+		else inverse[axis] = direction[axis] < 0 ? -1e20f : 1e20f;
+	}
+	return inverse;
+}
+
+// returns distance to where the ray enters the box, or max float if the box is missed or further than maxDistance
+float intersectBox(const AABB& box, vec3 source, vec3 inverseDirection, float maxDistance) {
+	float entry = -numeric_limits<float>::max();
+	float exit = numeric_limits<float>::max();
+	for (int axis = 0; axis < 3; axis++) {
+		float t0 = (box.minimum[axis] - source[axis]) * inverseDirection[axis];
+		float t1 = (box.maximum[axis] - source[axis]) * inverseDirection[axis];
+		if (t0 > t1) std::swap(t0, t1);
+		// a ray parallel to a face it starts on gives NaN, comparisons with NaN are false so that axis is skipped
+		if (t0 > entry) entry = t0;
+		if (t1 < exit) exit = t1;
+	}
+
+	if (exit >= entry && exit > 0 && entry < maxDistance) return entry;
+	return numeric_limits<float>::max();
+}
+
+// splits node into two children using binned surface area heuristic, becomes a leaf if splitting is not cheaper
+void subdivideBVH(BVH& bvh, int nodeIndex, const vector<AABB>& triangleBounds, const vector<vec3>& centroids, int depth) {
+	BVHNode node = bvh.nodes[nodeIndex];
+	if (node.count <= 2 || depth >= BVH_MAX_DEPTH) return;
+
+	AABB centroidBounds;
+	for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) centroidBounds.grow(centroids[bvh.triangleIndices[i]]);
+
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = node.bounds.area() * node.count;
+
+	for (int axis = 0; axis < 3; axis++) {
+		float lower = centroidBounds.minimum[axis];
+		float upper = centroidBounds.maximum[axis];
+		if (lower == upper) continue;
+
+		AABB binBounds[BVH_BINS];
+		int binCounts[BVH_BINS] = {};
+		float scale = BVH_BINS / (upper - lower);
+		for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+			int triangle = bvh.triangleIndices[i];
+			int bin = std::min(BVH_BINS - 1, (int)((centroids[triangle][axis] - lower) * scale));
+			binCounts[bin]++;
+			binBounds[bin].grow(triangleBounds[triangle]);
+		}
+
+		// sweep from both ends so each split plane is evaluated in constant time
+		float leftAreas[BVH_BINS - 1];
+		int leftCounts[BVH_BINS - 1];
+		AABB leftBox;
+		int leftSum = 0;
+		for (int i = 0; i < BVH_BINS - 1; i++) {
+			leftSum += binCounts[i];
+			leftBox.grow(binBounds[i]);
+			leftCounts[i] = leftSum;
+			leftAreas[i] = leftSum > 0 ? leftBox.area() : 0;
+		}
+		AABB rightBox;
+		int rightSum = 0;
+		for (int i = BVH_BINS - 1; i > 0; i--) {
+			rightSum += binCounts[i];
+			rightBox.grow(binBounds[i]);
+			float rightArea = rightSum > 0 ? rightBox.area() : 0;
+			float cost = leftAreas[i - 1] * leftCounts[i - 1] + rightArea * rightSum;
+			if (cost < bestCost && leftCounts[i - 1] > 0 && rightSum > 0) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+	if (bestAxis == -1) return;
+
+	// partition triangle indices so everything left of the split plane comes first
+	float lower = centroidBounds.minimum[bestAxis];
+	float scale = BVH_BINS / (centroidBounds.maximum[bestAxis] - lower);
+	int i = node.leftFirst;
+	int j = node.leftFirst + node.count - 1;
+	while (i <= j) {
+		int bin = std::min(BVH_BINS - 1, (int)((centroids[bvh.triangleIndices[i]][bestAxis] - lower) * scale));
+		if (bin < bestSplit) i++;
+		else std::swap(bvh.triangleIndices[i], bvh.triangleIndices[j--]);
+	}
+	int leftCount = i - node.leftFirst;
+
+	int leftChild = bvh.nodes.size();
+	BVHNode left, right;
+	left.leftFirst = node.leftFirst;
+	left.count = leftCount;
+	right.leftFirst = i;
+	right.count = node.count - leftCount;
+	for (int k = left.leftFirst; k < left.leftFirst + left.count; k++) left.bounds.grow(triangleBounds[bvh.triangleIndices[k]]);
+	for (int k = right.leftFirst; k < right.leftFirst + right.count; k++) right.bounds.grow(triangleBounds[bvh.triangleIndices[k]]);
+	bvh.nodes.push_back(left);
+	bvh.nodes.push_back(right);
+
+	bvh.nodes[nodeIndex].leftFirst = leftChild;
+	bvh.nodes[nodeIndex].count = 0;
+
+	subdivideBVH(bvh, leftChild, triangleBounds, centroids, depth + 1);
+	subdivideBVH(bvh, leftChild + 1, triangleBounds, centroids, depth + 1);
+}
+
+// builds the hierarchy once after the model is loaded, every ray query then walks it instead of all triangles
+BVH buildBVH(const Mesh& mesh) {
+	BVH bvh;
+	int triangleCount = mesh.triangleCount();
+	if (triangleCount == 0) return bvh;
+
+	vector<AABB> triangleBounds(triangleCount);
+	vector<vec3> centroids(triangleCount);
+	BVHNode root;
+	for (int i = 0; i < triangleCount; i++) {
+		for (int k = 0; k < 3; k++) triangleBounds[i].grow(mesh.position(i, k));
+		centroids[i] = (mesh.position(i, 0) + mesh.position(i, 1) + mesh.position(i, 2)) / 3.0f;
+		root.bounds.grow(triangleBounds[i]);
+		bvh.triangleIndices.push_back(i);
+	}
+	root.leftFirst = 0;
+	root.count = triangleCount;
+
+	bvh.nodes.reserve(2 * triangleCount);
+	bvh.nodes.push_back(root);
+	subdivideBVH(bvh, 0, triangleBounds, centroids, 0);
+	return bvh;
+}
@@ -1,6 +1,15 @@
 using namespace std;
 using namespace glm;
 
+// resolution the programs render at unless told otherwise, scale factors like 1500 were picked for an image this wide
+#define DEFAULT_WIDTH 640
+#define DEFAULT_HEIGHT 480
+
+// a scale factor picked for a DEFAULT_WIDTH wide image, for an image width pixels wide showing the same view
+float scaleForWidth(float scaleFactor, int width) {
+	return scaleFactor * width / DEFAULT_WIDTH;
+}
+
 glm::mat3 rotateMatrixX(float angle) {
 	glm::mat3 rotation(1.0, 0.0, 0.0,
 		0.0, cos(angle), sin(angle),
@@ -25,3 +34,25 @@ glm::mat3 lookat(glm::vec3 cameraPos, glm::vec3 target = glm::vec3(0.25, 0.25, 0
 	// return transpose(newOrientation);
 	return newOrientation;
 }
+
+// One step of the logo animation: slide right, orbit round to the back of the model, then slide back left.
+// move is what the last step returned (start with 1), returns which of the 3 parts this step was in, or 0 once it is over.
+int stepLogoAnimation(glm::vec3& cameraPos, glm::mat3& cameraOrientation, int move) {
+	if (cameraPos.x <= 0.25 && move == 1) {
+		cameraPos.x += 0.01;
+		return 1;
+	}
+	else if (cameraPos.z > -4 && move >= 1) {
+		cameraPos = cameraPos * rotateMatrixY(0.05);
+		cameraPos = cameraPos * rotateMatrixX(0.05);
+		cameraOrientation = lookat(cameraPos);
+		return 2;
+	}
+	else if (cameraPos.x >= -0.5) {
+		cameraPos.x -= 0.01;
+		return 3;
+	}
+	else {
+		return 0;
+	}
+}
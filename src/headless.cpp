@@ -0,0 +1,193 @@
+#include <renderer.h>
+#include <chrono>
+
+using namespace std;
+using namespace glm;
+
+// Renders frames without opening a window (or needing SDL or a display) and writes them to image files,
+// for batch rendering on machines with no screen. Run with --help for the options.
+
+const char* usage =
+	"usage: headless [options]\n"
+	"  --scene logo|cornell   scene to load (logo.obj or new-cornell-box.obj from the working directory), default logo\n"
+	"  --obj FILE --mtl FILE  load these files instead, with --scale S (default 0.001)\n"
+	"                         and --loader flat|textured|smooth (default textured)\n"
+	"  --mode MODE            wireframe, raster or raytrace (or 0, 1, 2 like the window's keys), default raytrace\n"
+	"  --lighting N           ray tracer lighting mode 0 to 5 (keys z to n in the window), default 3\n"
+	"  --camera X,Y,Z         camera position, default 0,0.25,4\n"
+	"  --look                 turn the camera to look at the model (the window's l key)\n"
+	"  --light X,Y,Z          light position, default 0,0,1\n"
+	"  --focal F              focal length, default 2\n"
+	"  --size WxH             image size, default 640x480\n"
+	"  --zoom Z               image plane scale factor, default 1500 at 640 pixels wide (scaled with the width so\n"
+	"                         other sizes show the same view)\n"
+	"  --frames N             how many frames to render, default 1\n"
+	"  --orbit                orbit the camera around the model between frames (the window's o key)\n"
+	"  --output FILE          .ppm or .png file to write, numbered (name_0001.png) when there is more than one frame,\n"
+	"                         default output.ppm\n"
+	"  --threads N            cores to use, default all of them\n"
+	"  --trace FILE           also write each frame's timers and counters as Chrome trace JSON, numbered like --output\n"
+	"                         (needs a build with PROFILE defined)\n";
+
+// x,y,z to a vector, false if it is not 3 numbers
+bool parseVector(const string& text, vec3& result) {
+	vector<string> parts = split(text, ',');
+	if (parts.size() != 3) return false;
+	try {
+		for (int k = 0; k < 3; k++) result[k] = stof(parts[k]);
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+	return true;
+}
+
+// output with the frame number before its extension, when more than one frame is rendered
+string frameFileName(const string& output, int frame, int frames) {
+	if (frames == 1) return output;
+	char number[16];
+	snprintf(number, sizeof(number), "_%04d", frame);
+	size_t dot = output.rfind('.');
+	if (dot == string::npos) return output + number;
+	return output.substr(0, dot) + number + output.substr(dot);
+}
+
+bool endsWith(const string& text, const string& ending) {
+	return text.size() >= ending.size() && text.compare(text.size() - ending.size(), ending.size(), ending) == 0;
+}
+
+int main(int argc, char* argv[]) {
+	string objFile = "logo.obj";
+	string mtlFile = "materials.mtl";
+	float scalingFactor = 0.001;
+	Mesh (*loader)(string, float, const MaterialTable&) = unloadTextureFile;
+	int renderMode = 2;
+	int lightingMode = 3;
+	vec3 cameraPos(0, 0.25, 4.0);
+	mat3 cameraOrientation(1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0);
+	bool look = false;
+	vec3 light(0.0, 0.0, 1.0);
+	float focalLength = 2;
+	float scaleFactor = 1500;
+	bool zoomGiven = false;
+	int width = DEFAULT_WIDTH;
+	int height = DEFAULT_HEIGHT;
+	int frames = 1;
+	bool orbit = false;
+	string output = "output.ppm";
+	string trace;
+
+	for (int i = 1; i < argc; i++) {
+		string option = argv[i];
+		bool hasValue = i + 1 < argc;
+		string value = hasValue ? argv[i + 1] : "";
+		bool ok = true;
+		try {
+			if (option == "--help" || option == "-h") {
+				cout << usage;
+				return 0;
+			}
+			else if (option == "--look") look = true;
+			else if (option == "--orbit") orbit = true;
+			else if (!hasValue) ok = false;
+			else {
+				i++;
+				if (option == "--scene") {
+					if (value == "logo") {
+						objFile = "logo.obj";
+						mtlFile = "materials.mtl";
+						scalingFactor = 0.001;
+						loader = unloadTextureFile;
+					}
+					else if (value == "cornell") {
+						objFile = "new-cornell-box.obj";
+						mtlFile = "new-cornell-box.mtl";
+						scalingFactor = 0.17;
+						loader = unloadNewFile;
+					}
+					else ok = false;
+				}
+				else if (option == "--obj") objFile = value;
+				else if (option == "--mtl") mtlFile = value;
+				else if (option == "--scale") scalingFactor = stof(value);
+				else if (option == "--loader") {
+					if (value == "flat") loader = unloadobjFile;
+					else if (value == "textured") loader = unloadTextureFile;
+					else if (value == "smooth") loader = unloadNewFile;
+					else ok = false;
+				}
+				else if (option == "--mode") {
+					if (value == "wireframe" || value == "0") renderMode = 0;
+					else if (value == "raster" || value == "1") renderMode = 1;
+					else if (value == "raytrace" || value == "2") renderMode = 2;
+					else ok = false;
+				}
+				else if (option == "--lighting") lightingMode = stoi(value);
+				else if (option == "--camera") ok = parseVector(value, cameraPos);
+				else if (option == "--light") ok = parseVector(value, light);
+				else if (option == "--focal") focalLength = stof(value);
+				else if (option == "--zoom") {
+					scaleFactor = stof(value);
+					zoomGiven = true;
+				}
+				else if (option == "--size") ok = parseResolution(value, width, height);
+				else if (option == "--frames") frames = stoi(value);
+				else if (option == "--output") output = value;
+				else if (option == "--threads") threadPool.resize(stoi(value));
+				else if (option == "--trace") trace = value;
+				else ok = false;
+			}
+		}
+		catch (const std::exception&) {
+			ok = false;
+		}
+		if (!ok || frames < 1) {
+			cout << "bad option " << option << (hasValue ? " " + value : "") << "\n" << usage;
+			return 1;
+		}
+	}
+	if (!endsWith(output, ".ppm") && !endsWith(output, ".png")) {
+		cout << "output must end in .ppm or .png\n";
+		return 1;
+	}
+#ifndef PROFILE
+	if (!trace.empty()) {
+		cout << "--trace needs a build with PROFILE defined (cmake -DPROFILE=ON or make headless PROFILE=1)\n";
+		return 1;
+	}
+#endif
+	if (!ifstream(objFile)) {
+		cout << "could not open " << objFile << "\n";
+		return 1;
+	}
+
+	const Scene scene = loadCachedScene(objFile, mtlFile, scalingFactor, loader);
+	if (look) cameraOrientation = lookat(cameraPos);
+	if (!zoomGiven) scaleFactor = scaleForWidth(scaleFactor, width);
+	FrameBuffer frame(width, height);
+	DepthBuffer depthBuffer;
+
+	auto start = chrono::steady_clock::now();
+	for (int i = 1; i <= frames; i++) {
+		if (orbit && i > 1) {
+			cameraPos = cameraPos * rotateMatrixY(0.05);
+			cameraPos = cameraPos * rotateMatrixX(0.05);
+			cameraOrientation = lookat(cameraPos);
+		}
+		auto frameStart = chrono::steady_clock::now();
+		if (renderMode == 0) renderWireFrame(frame, scene, cameraPos, focalLength, scaleFactor, cameraOrientation);
+		if (renderMode == 1) renderRasterizedScene(frame, depthBuffer, scene, cameraPos, focalLength, scaleFactor, cameraOrientation);
+		if (renderMode == 2) renderRayTracedScene(frame, scene, cameraPos, cameraOrientation, light, lightingMode, focalLength, scaleFactor);
+		double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count();
+
+		string fileName = frameFileName(output, i, frames);
+		if (endsWith(fileName, ".png")) frame.savePNG(fileName);
+		else frame.savePPM(fileName);
+		cout << fileName << " " << milliseconds << " ms" << endl;
+#ifdef PROFILE
+		if (!trace.empty() && !writeProfileTrace(frameFileName(trace, i, frames))) cout << "could not write " << frameFileName(trace, i, frames) << endl;
+#endif
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << frames << " frames in " << seconds << " s (" << frames / seconds << " frames/s)" << endl;
+}
@@ -2,28 +2,25 @@ using namespace std;
 using namespace glm;
 
 
-RayTriangleIntersection getClosestIntersection(glm::vec3 source, glm::vec3 rayDirection, vector<ModelTriangle> triangles, int triangleIndex, int material);
+HitRecord findClosestHit(glm::vec3 source, glm::vec3 rayDirection, const Scene& scene, int triangleIndex, int skipSurface);
+bool occluded(glm::vec3 source, glm::vec3 rayDirection, float maxDistance, const Scene& scene, int triangleIndex);
 
 
 // returns black if surface cannot see light
-float hardShadowLighting(RayTriangleIntersection surface, vector<ModelTriangle> triangles, vec3 light) {
+float hardShadowLighting(const RayTriangleIntersection& surface, const Scene& scene, vec3 light) {
+	PROFILE_TIME(COUNTER_SHADOW_NANOSECONDS);
 	// calculate direction of surface to light source
 	vec3 rayShadowDirection = light - surface.intersectionPoint;
-	rayShadowDirection = normalize(rayShadowDirection);
-	vec3 normalizedIntersection = normalize(surface.intersectionPoint);
+	float distanceToLight = length(rayShadowDirection);
+	rayShadowDirection = rayShadowDirection / distanceToLight;
 
-	// find closest intersection between light source
-	RayTriangleIntersection shadowRay = getClosestIntersection(surface.intersectionPoint, rayShadowDirection, triangles, surface.triangleIndex, -1);
-	float distanceToIntersection = distance(normalize(shadowRay.intersectionPoint), normalizedIntersection);
-	float distanceToLight = distance(light, normalizedIntersection);
-
-	// if distance to intersection is closer to surface then colour set triangle colour to black
-	if (distanceToIntersection < distanceToLight) return 0;
+	// if anything sits between the surface and the light then colour set triangle colour to black
+	if (occluded(surface.intersectionPoint, rayShadowDirection, distanceToLight, scene, surface.triangleIndex)) return 0;
 	else return 1;
 }
 
 // darkens pixels based on distance from light
-float proximityLighting(RayTriangleIntersection surface, vec3 light) {
+float proximityLighting(const RayTriangleIntersection& surface, vec3 light) {
 	float lightDistance = distance(surface.intersectionPoint, light);
 	float brightness = 1 / (3 * pow(lightDistance, 2));
 
@@ -32,7 +29,7 @@ float proximityLighting(RayTriangleIntersection surface, vec3 light) {
 }
 
 // darkens pixels based on angle from light
-float diffuseLighting(RayTriangleIntersection surface, vec3 light) {
+float diffuseLighting(const RayTriangleIntersection& surface, vec3 light) {
 	float brightness = proximityLighting(surface, light);
 
 	// find angle of incidence in accordance to light
@@ -44,7 +41,7 @@ float diffuseLighting(RayTriangleIntersection surface, vec3 light) {
 }
 
 // specularly illuminated surface
-float specularLighting(RayTriangleIntersection surface, vec3 cameraPos, vec3 light, int spread = 256) {
+float specularLighting(const RayTriangleIntersection& surface, vec3 cameraPos, vec3 light, int spread = 256) {
 	vec3 lightVector = light - surface.intersectionPoint;
 	vec3 normal = surface.intersectedTriangle.normal;
 	vec3 reflectionVector = normalize(lightVector - (2.0f * normal * dot(lightVector, normal)));
@@ -54,8 +51,8 @@ float specularLighting(RayTriangleIntersection surface, vec3 cameraPos, vec3 lig
 	return brightness;
 }
 
-float allLighting(RayTriangleIntersection surface, vec3 cameraPos, vector<ModelTriangle> triangles, vec3 light) {
-	float shadow = hardShadowLighting(surface, triangles, light);
+float allLighting(const RayTriangleIntersection& surface, vec3 cameraPos, const Scene& scene, vec3 light) {
+	float shadow = hardShadowLighting(surface, scene, light);
 	float diffuse = diffuseLighting(surface, light);
 	float spec = specularLighting(surface, cameraPos, light, 16);
 
@@ -64,15 +61,15 @@ float allLighting(RayTriangleIntersection surface, vec3 cameraPos, vector<ModelT
 	else return diffuse;
 }
 
-vec3 vectorOfRecflection(RayTriangleIntersection surface, vec3 iv) {
+vec3 vectorOfRecflection(const RayTriangleIntersection& surface, vec3 iv) {
 	vec3 normal = normalize(surface.intersectedTriangle.normal);
 	return normalize(iv - (normal * 2.0f * dot(iv, normal)));
 }
 
-vec3 vectorOfRefraction(RayTriangleIntersection surface, vec3 iv, float ri1, float ri2) {
+vec3 vectorOfRefraction(const RayTriangleIntersection& surface, vec3 iv, float ri1, float ri2) {
 	// with help from scratch a pixel
 	vec3 normal = normalize(surface.intersectedTriangle.normal);
-	float cosi = clamp(dot(iv, normal), -1.0f, 1.0f);
+	float cosi = glm::clamp(dot(iv, normal), -1.0f, 1.0f);
 
 	// going into surface
 	if (cosi < 0) return (ri1/ri2 * iv) - (ri1/ri2 * -cosi) * normal;
@@ -81,29 +78,28 @@ vec3 vectorOfRefraction(RayTriangleIntersection surface, vec3 iv, float ri1, flo
 }
 
 // purely changes triangle colour to closest triangle to reflected ray
-RayTriangleIntersection checkMirror(RayTriangleIntersection surface, vector<ModelTriangle> triangles, vec3 light) {
-	// simple mirror surface reflecting everything perfectly
+RayTriangleIntersection checkMirror(RayTriangleIntersection surface, const Scene& scene, vec3 light) {
+	const Material& material = scene.materials[surface.intersectedTriangle.material];
+	if (material.surface == SURFACE_DIFFUSE) return surface;
+	PROFILE_TIME(COUNTER_REFLECTION_NANOSECONDS);
+
 	vec3 toLight = normalize(light - surface.intersectionPoint);
-	float reflectivity = 0;
+	float reflectivity = material.reflectivity;
 	Colour newColour = Colour(255, 255, 255);
 	vec3 reflection = -vectorOfRecflection(surface, toLight);
-	// mirror reflecting everything
-	if (surface.intersectedTriangle.material == 1) {
-		reflectivity = 1;
-		newColour = getClosestIntersection(surface.intersectionPoint, reflection, triangles, surface.triangleIndex, -1).intersectedTriangle.colour;
-	} 
-	// metallic surface
-	else if (surface.intersectedTriangle.material == 2) {
-		reflectivity = 0.25;
-		newColour = getClosestIntersection(surface.intersectionPoint, reflection, triangles, surface.triangleIndex, -1).intersectedTriangle.colour;
-	} // refractive surface (glass with RI 1.5)
-	else if (surface.intersectedTriangle.material == 3) {
-		reflectivity = 0.75;
-		vec3 refraction = -vectorOfRefraction(surface, toLight, 1.5, 1.0);
-		newColour = getClosestIntersection(surface.intersectionPoint, refraction, triangles, surface.triangleIndex, 3).intersectedTriangle.colour;
+	// mirror reflecting everything, or metallic surface reflecting some of it
+	if (material.surface == SURFACE_MIRROR || material.surface == SURFACE_METAL) {
+		PROFILE_COUNT(COUNTER_SECONDARY_RAYS, 1);
+		newColour = hitColour(findClosestHit(surface.intersectionPoint, reflection, scene, surface.triangleIndex, -1), scene);
+	}
+	// refractive surface (glass)
+	else if (material.surface == SURFACE_GLASS) {
+		vec3 refraction = -vectorOfRefraction(surface, toLight, material.ior, 1.0);
+		PROFILE_COUNT(COUNTER_SECONDARY_RAYS, 2);
+		newColour = hitColour(findClosestHit(surface.intersectionPoint, refraction, scene, surface.triangleIndex, SURFACE_GLASS), scene);
 
 		// show subtle reflection 
-		surface.intersectedTriangle.colour = getClosestIntersection(surface.intersectionPoint, reflection, triangles, surface.triangleIndex, 2).intersectedTriangle.colour;
+		surface.intersectedTriangle.colour = hitColour(findClosestHit(surface.intersectionPoint, reflection, scene, surface.triangleIndex, SURFACE_METAL), scene);
 
 	}
 	int r0 = newColour.red * reflectivity;
@@ -118,14 +114,14 @@ RayTriangleIntersection checkMirror(RayTriangleIntersection surface, vector<Mode
 	return surface;
 }
 
-Colour calculateBrightness(RayTriangleIntersection surface, float brightness, bool ambiance = true) {
+Colour calculateBrightness(const RayTriangleIntersection& surface, float brightness, bool ambiance = true) {
 	Colour colour = surface.intersectedTriangle.colour;
 	// ambiance and defaulted to true
 	if (brightness < 0.2 && ambiance) brightness = 0.2;
 	return Colour(colour.red * brightness, colour.green * brightness, colour.blue * brightness);
 }
 
-float shadingHelper(RayTriangleIntersection surface, vec3 point, vec3 normal, vec3 cameraPos, vec3 light) {
+float shadingHelper(const RayTriangleIntersection& surface, vec3 point, vec3 normal, vec3 cameraPos, vec3 light) {
 	// combine brightness functions 
 	float brightness = proximityLighting(surface, light);
 	vec3 toLight = light - point;
@@ -137,7 +133,7 @@ float shadingHelper(RayTriangleIntersection surface, vec3 point, vec3 normal, ve
 	return std::min((brightness * angleOfIncidence) + spec, 1.0f);
 }
 
-float gouraudShade(RayTriangleIntersection surface, vec3 cameraPos, vec3 light) {
+float gouraudShade(const RayTriangleIntersection& surface, vec3 cameraPos, vec3 light) {
 	// get brightness value for each vertex so can be interpolated
 	float b0 = shadingHelper(surface, surface.intersectionPoint, surface.intersectedTriangle.vertex_normals[0], cameraPos, light);
 	float b1 = shadingHelper(surface, surface.intersectionPoint, surface.intersectedTriangle.vertex_normals[1], cameraPos, light);
@@ -152,7 +148,7 @@ float gouraudShade(RayTriangleIntersection surface, vec3 cameraPos, vec3 light)
 	return brightness;
 }
 
-float phongShade(RayTriangleIntersection surface, vec3 cameraPos, vec3 light) {
+float phongShade(const RayTriangleIntersection& surface, vec3 cameraPos, vec3 light) {
 	// get brightness value for each vertex so can be interpolated
 	vec3 n0 = surface.intersectedTriangle.vertex_normals[0];
 	vec3 n1 = surface.intersectedTriangle.vertex_normals[1];
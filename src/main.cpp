@@ -1,31 +1,9 @@
-#include <CanvasTriangle.h>
 #include <DrawingWindow.h>
-#include <Utils.h>
-#include <fstream>
-#include <vector>
-#include <algorithm>
-#include <glm/glm.hpp>
-
-#include <CanvasPoint.h>
-#include <Colour.h>
-#include <TextureMap.h>
-#include <ModelTriangle.h>
-#include <RayTriangleIntersection.h>
-
-#include <camera.h>
-#include <interpolate.h>
-#include <lighting.h>
-#include <rasterize.h>
-#include <raytrace.h>
-#include <readFile.h>
-#include <wireframe.h>
+#include <renderer.h>
 
 using namespace std;
 using namespace glm;
 
-#define WIDTH 640
-#define HEIGHT 480
-
 
 vec3 cameraPos(0, 0.25, 4.0);
 
@@ -38,19 +16,29 @@ float scaleFactor = 1500;
 mat3 cameraOrientation(1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0);
 
 bool orbit = false;
+// ray trace a little each frame, sharpening the picture while the camera is still, instead of waiting for whole frames
+bool progressive = true;
+ProgressiveTrace progressiveTrace;
+// what the rasterizer drew last, so triangles drawn over the window with j are hidden behind the model
+DepthBuffer depthBuffer;
 vec3 light(0.0, 0.0, 1.0);
 //vec3 light(0.0, 0.4, 0.2);
 
-//vector<Colour> c = unloadMaterialFile("new-cornell-box.mtl");
-//vector<ModelTriangle> triangles = unloadNewFile("new-cornell-box.obj", 0.17, c);
+//const Scene scene = loadCachedScene("new-cornell-box.obj", "new-cornell-box.mtl", 0.17, unloadNewFile);
+
+const Scene scene = loadCachedScene("logo.obj", "materials.mtl", 0.001, unloadTextureFile);
 
-vector<Colour> c = unloadMaterialFile("materials.mtl");
-vector<ModelTriangle> triangles = unloadTextureFile("logo.obj", 0.001, c);
 
+// refines the progressive ray traced picture a little, true once it is finished
+bool refine(DrawingWindow& window) {
+	return renderRayTracedProgressive(window, scene, cameraPos, cameraOrientation, light, lightingMode, focalLength, scaleFactor, progressiveTrace);
+}
 
 // draws relevant items on screen
 void draw(DrawingWindow& window) {
-	window.clearPixels();
+	// the progressive ray tracer carries on from what it drew last time
+	bool refining = renderMode == 2 && progressive;
+	if (!refining) window.clearPixels();
 
 	if (orbit) {
 		cameraPos = cameraPos * rotateMatrixY(0.05);
@@ -58,34 +46,22 @@ void draw(DrawingWindow& window) {
 		cameraOrientation = lookat(cameraPos);
 	}
 
-	if (renderMode == 0) renderWireFrame(window, triangles, cameraPos, focalLength, scaleFactor, cameraOrientation);
-	if (renderMode == 1) renderRasterizedScene(window, triangles, cameraPos, focalLength, scaleFactor, cameraOrientation);
-	if (renderMode == 2) renderRayTracedScene(window, triangles, cameraPos, cameraOrientation, light, lightingMode, focalLength, scaleFactor);
+	if (renderMode == 0) renderWireFrame(window, scene, cameraPos, focalLength, scaleFactor, cameraOrientation);
+	if (renderMode == 1) renderRasterizedScene(window, depthBuffer, scene, cameraPos, focalLength, scaleFactor, cameraOrientation);
+	if (renderMode == 2 && !progressive) renderRayTracedScene(window, scene, cameraPos, cameraOrientation, light, lightingMode, focalLength, scaleFactor);
+	if (refining) refine(window);
+	// anything else drawn over the window means the next progressive picture starts from scratch
+	else progressiveTrace.restart();
 
 }
 
 // CAMERA MOVEMENT FOR LOGO
+// wireframe while moving round the model, rasterized for the last stretch
 int handleLogoAnimation(int move) {
-	if (cameraPos.x <= 0.25 && move == 1) {
-		renderMode = 0;
-		cameraPos.x += 0.01;
-		return 1;
-	}
-	else if (cameraPos.z > -4 && move >= 1) {
-		renderMode = 0;
-		cameraPos = cameraPos * rotateMatrixY(0.05);
-		cameraPos = cameraPos * rotateMatrixX(0.05);
-		cameraOrientation = lookat(cameraPos);
-		return 2;
-	}
-	else if (cameraPos.x >= -0.5) {
-		renderMode = 1;
-		cameraPos.x -= 0.01;
-		return 3;
-	}
-	else {
-		return 0;
-	}
+	move = stepLogoAnimation(cameraPos, cameraOrientation, move);
+	if (move == 1 || move == 2) renderMode = 0;
+	else if (move == 3) renderMode = 1;
+	return move;
 }
 
 // handles keypresses to do certain events
@@ -121,21 +97,59 @@ void handleEvent(SDL_Event event, DrawingWindow& window) {
 
 		else if (event.key.keysym.sym == SDLK_o) orbit = !orbit; // orbit the model
 
+		else if (event.key.keysym.sym == SDLK_p) progressive = !progressive; // ray trace progressively or a whole frame at a time
+
 		else if (event.key.keysym.sym == SDLK_l) cameraOrientation = lookat(cameraPos); // if model out of view camera looks at model
 
-		else if (event.key.keysym.sym == SDLK_u) randomStrokedTriangle(window); // draws a random unfilled triangle on screen
+		else if (event.key.keysym.sym == SDLK_u) {
+			randomStrokedTriangle(window); // draws a random unfilled triangle on screen
+			progressiveTrace.restart();
+		}
 
-		else if (event.key.keysym.sym == SDLK_j) randomFilledTriangle(window); // draws a random filled triangle on screen
+		else if (event.key.keysym.sym == SDLK_j) {
+			randomFilledTriangle(window, depthBuffer); // draws a random filled triangle on screen
+			progressiveTrace.restart();
+		}
+#ifdef PROFILE
+		else if (event.key.keysym.sym == SDLK_t && writeProfileTrace("trace.json")) std::cout << "last frame's trace written to trace.json" << std::endl;
+#endif
 
 	}
 	else if (event.type == SDL_MOUSEBUTTONDOWN) {
+		// saves the finished picture rather than however far the progressive ray tracer has got
+		if (renderMode == 2 && progressive) while (!refine(window)) {}
 		window.savePPM("output.ppm");
 		window.saveBMP("output.bmp");
 	}
 }
 
-int main(int argc, char* mrgv[]) {
-	DrawingWindow window = DrawingWindow(WIDTH, HEIGHT, false);
+int main(int argc, char* argv[]) {
+	int width = DEFAULT_WIDTH;
+	int height = DEFAULT_HEIGHT;
+	for (int i = 1; i < argc; i++) {
+		// --threads N sets how many cores the ray tracer uses, defaults to all of them
+		if (string(argv[i]) == "--threads" && i + 1 < argc) {
+			int threads = 0;
+			try {
+				threads = stoi(argv[++i]);
+			}
+			catch (const std::exception&) {}
+			if (threads < 1) {
+				cout << "--threads takes a number of cores like 4" << endl;
+				return 1;
+			}
+			threadPool.resize(threads);
+		}
+		// --size WxH sets the window size, defaults to 640x480
+		else if (string(argv[i]) == "--size" && i + 1 < argc && !parseResolution(argv[++i], width, height)) {
+			cout << "--size takes a width and height like 1280x720" << endl;
+			return 1;
+		}
+	}
+	// keeps the same view whatever the window size
+	scaleFactor = scaleForWidth(scaleFactor, width);
+
+	DrawingWindow window = DrawingWindow(width, height, false);
 	SDL_Event event;
 
 	// START POS FOR raytraced render
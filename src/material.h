@@ -0,0 +1,99 @@
+using namespace std;
+using namespace glm;
+
+// how light leaves a surface in the ray tracer, the numbers are the ones findClosestHit filters on
+#define SURFACE_DIFFUSE 0
+#define SURFACE_MIRROR 1
+#define SURFACE_METAL 2
+#define SURFACE_GLASS 3
+
+// which brightness function the ray tracer uses for a surface in lighting modes 2 and up
+#define SHADING_DEFAULT 0
+#define SHADING_PHONG 1
+
+// what texture lookups outside 0 to 1 do, set by map_Kd's -clamp option
+#define TEXTURE_CLAMP 0
+#define TEXTURE_REPEAT 1
+
+// Everything about a material that rendering needs, looked up by the small integer id stored in ModelTriangle::material.
+// Filled in from the .mtl file once at load time so shading never has to compare names.
+struct Material {
+	string name;
+	Colour albedo = Colour(0, 0, 0);
+	int surface = SURFACE_DIFFUSE;
+	// share of the colour taken from whatever a mirror, metal or glass surface reflects or refracts
+	float reflectivity = 0;
+	// index of refraction, only used by glass
+	float ior = 1.0;
+	int shading = SHADING_DEFAULT;
+	// position in MaterialTable::texturePaths, -1 if the material has no map_Kd
+	int texture = -1;
+	int textureWrap = TEXTURE_CLAMP;
+};
+
+// every material of a scene, id 0 is the black fallback used before any usemtl and for unknown names
+struct MaterialTable {
+	vector<Material> materials = { Material() };
+	// each distinct map_Kd path once, materials refer to them by position
+	vector<string> texturePaths;
+
+	const Material& operator[](int id) const {
+		return materials[id];
+	}
+
+	// id of the material with this name, 0 if there is none
+	int find(const string& name) const {
+		for (size_t i = 1; i < materials.size(); i++) {
+			if (materials[i].name == name) return i;
+		}
+		return 0;
+	}
+
+	int addTexture(const string& path) {
+		for (size_t i = 0; i < texturePaths.size(); i++) {
+			if (texturePaths[i] == path) return i;
+		}
+		texturePaths.push_back(path);
+		return texturePaths.size() - 1;
+	}
+};
+
+// Settings for a newly declared material before its keys are read. The scenes were made before the .mtl files
+// said anything about shading, so these names keep their old look unless the file overrides them: Red always has
+// highlights, and with namedSurfaces (only the smooth loader, unloadNewFile, ever did this) Grey is metal and Orange glass.
+Material defaultMaterial(const string& name, bool namedSurfaces) {
+	Material material;
+	material.name = name;
+	if (name == "Grey" && namedSurfaces) {
+		material.surface = SURFACE_METAL;
+		material.reflectivity = 0.25;
+	}
+	else if (name == "Orange" && namedSurfaces) {
+		material.surface = SURFACE_GLASS;
+		material.reflectivity = 0.75;
+		material.ior = 1.5;
+	}
+	else if (name == "Red") material.shading = SHADING_PHONG;
+	return material;
+}
+
+// applies an illum model from a .mtl file, 2 turns on highlights, 3 is a mirror, 5 is metal (fresnel reflection)
+// and 7 is glass (refraction), anything else is plain diffuse
+// reflectivity and ior get the usual value for the surface unless Pm or Ni already set them
+void applyIllumination(Material& material, int illum) {
+	material.shading = illum == 2 ? SHADING_PHONG : SHADING_DEFAULT;
+	if (illum == 3) {
+		material.surface = SURFACE_MIRROR;
+		if (material.reflectivity == 0) material.reflectivity = 1;
+	}
+	else if (illum == 5) {
+		material.surface = SURFACE_METAL;
+		if (material.reflectivity == 0) material.reflectivity = 0.25;
+	}
+	else if (illum == 7) {
+		material.surface = SURFACE_GLASS;
+		if (material.reflectivity == 0) material.reflectivity = 0.75;
+		if (material.ior == 1.0) material.ior = 1.5;
+	}
+	else material.surface = SURFACE_DIFFUSE;
+}
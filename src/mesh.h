@@ -0,0 +1,55 @@
+using namespace std;
+using namespace glm;
+
+// Triangles sharing their vertices: every vertex (position, smoothed normal and texture point) is stored once
+// and each triangle is three indices into those buffers, plus the id of its material.
+// Renderers work from this directly, a full ModelTriangle is only put together for the surface a ray ends up shading.
+struct Mesh {
+	vector<vec3> positions;
+	// zero for loaders that do not work out vertex normals
+	vector<vec3> normals;
+	vector<TexturePoint> texturePoints;
+	// three per triangle
+	vector<uint32_t> indices;
+	// per triangle
+	vector<int> materials;
+	// per triangle, 1 if the face gave texture coordinates, it is then drawn white with its material's texture
+	vector<uint8_t> textured;
+
+	int triangleCount() const {
+		return materials.size();
+	}
+
+	vec3 position(int t, int corner) const {
+		return positions[indices[3 * t + corner]];
+	}
+
+	// (unnormalized) face normal worked out from 2 edges
+	vec3 faceNormal(int t) const {
+		vec3 v0 = position(t, 0);
+		return glm::cross(position(t, 1) - v0, position(t, 2) - v0);
+	}
+
+	// colour triangle t is drawn with, flagged as textured if the rasterizer should sample a texture for it
+	Colour colour(int t, const MaterialTable& table) const {
+		Colour colour(255, 255, 255);
+		if (!textured[t]) {
+			const Material& material = table[materials[t]];
+			colour = Colour(material.albedo.red, material.albedo.green, material.albedo.blue);
+		}
+		colour.texture = textured[t] || table[materials[t]].texture != -1;
+		return colour;
+	}
+
+	// triangle t laid out as a ModelTriangle, for the shading code that works with those
+	ModelTriangle triangle(int t, const MaterialTable& table) const {
+		ModelTriangle triangle(position(t, 0), position(t, 1), position(t, 2), colour(t, table));
+		for (int k = 0; k < 3; k++) {
+			triangle.texturePoints[k] = texturePoints[indices[3 * t + k]];
+			triangle.vertex_normals[k] = normals[indices[3 * t + k]];
+		}
+		triangle.normal = faceNormal(t);
+		triangle.material = materials[t];
+		return triangle;
+	}
+};
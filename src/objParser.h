@@ -0,0 +1,287 @@
+#include <charconv>
+#include <cstring>
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+// A whole file as read-only memory. Mapped where the OS supports it, so parsing reads the page cache directly
+// instead of copying the file through a stream, otherwise (Windows) read into a buffer in one go.
+class MappedFile {
+	const char* bytes = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	vector<char> buffer;
+#else
+	void* mapping = nullptr;
+#endif
+
+public:
+	MappedFile(const string& fileName) {
+#ifdef _WIN32
+		ifstream file(fileName, ios::binary | ios::ate);
+		if (!file) return;
+		buffer.resize(file.tellg());
+		file.seekg(0);
+		file.read(buffer.data(), buffer.size());
+		bytes = buffer.data();
+		length = buffer.size();
+#else
+		int descriptor = open(fileName.c_str(), O_RDONLY);
+		if (descriptor == -1) return;
+		struct stat status;
+		if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+			void* address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if (address != MAP_FAILED) {
+				mapping = address;
+				bytes = static_cast<const char*>(address);
+				length = status.st_size;
+				madvise(address, length, MADV_SEQUENTIAL);
+			}
+		}
+		// the mapping stays valid after the descriptor is closed
+		close(descriptor);
+#endif
+	}
+
+	~MappedFile() {
+#ifndef _WIN32
+		if (mapping) munmap(mapping, length);
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* begin() const { return bytes; }
+	const char* end() const { return bytes + length; }
+	size_t size() const { return length; }
+};
+
+// one corner of a face, each is a position in the matching ObjMesh array or -1 if the face did not give one
+struct ObjCorner {
+	int position = -1;
+	int texture = -1;
+	int normal = -1;
+};
+
+// Contents of an .obj file kept indexed the way the file stores them, every face is split into triangles
+// (polygons as a fan around their first corner) with three corners each and the id of the material it uses.
+struct ObjMesh {
+	vector<vec3> positions;
+	vector<TexturePoint> texturePoints;
+	vector<vec3> normals;
+	vector<ObjCorner> corners;
+	vector<int> materials;
+
+	int triangleCount() const {
+		return materials.size();
+	}
+};
+
+// how many of each kind of vertex come before a chunk of the file, so its faces can be resolved against the whole file
+struct ObjOffsets {
+	int positions = 0;
+	int texturePoints = 0;
+	int normals = 0;
+};
+
+inline const char* skipSpaces(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+	return p;
+}
+
+inline const char* skipToken(const char* p, const char* end) {
+	while (p < end && *p != ' ' && *p != '\t' && *p != '\r') p++;
+	return p;
+}
+
+// reads a float at p and moves p past it, from_chars does not take a leading + so that is skipped first
+inline bool parseFloat(const char*& p, const char* end, float& value) {
+	p = skipSpaces(p, end);
+	if (p < end && *p == '+') p++;
+	from_chars_result result = from_chars(p, end, value);
+	if (result.ec != errc()) return false;
+	p = result.ptr;
+	return true;
+}
+
+inline bool parseInt(const char*& p, const char* end, int& value) {
+	if (p < end && *p == '+') p++;
+	from_chars_result result = from_chars(p, end, value);
+	if (result.ec != errc()) return false;
+	p = result.ptr;
+	return true;
+}
+
+// turns a 1-based (or negative, counting back from the last one read) .obj index into a 0-based one, -1 if it is out of range
+inline int resolveObjIndex(int index, int count) {
+	if (index > 0 && index <= count) return index - 1;
+	if (index < 0 && -index <= count) return count + index;
+	return -1;
+}
+
+// reads one face corner, any of v, v/vt, v//vn or v/vt/vn, empty fields (like "1/") are allowed
+inline bool parseCorner(const char*& p, const char* end, const ObjMesh& mesh, const ObjOffsets& offsets, ObjCorner& corner) {
+	int index;
+	if (!parseInt(p, end, index)) return false;
+	corner = ObjCorner();
+	corner.position = resolveObjIndex(index, offsets.positions + mesh.positions.size());
+	if (corner.position == -1) return false;
+	if (p < end && *p == '/') {
+		p++;
+		if (parseInt(p, end, index)) corner.texture = resolveObjIndex(index, offsets.texturePoints + mesh.texturePoints.size());
+		if (p < end && *p == '/') {
+			p++;
+			if (parseInt(p, end, index)) corner.normal = resolveObjIndex(index, offsets.normals + mesh.normals.size());
+		}
+	}
+	return true;
+}
+
+// counts the v, vt and vn lines in [p, end) without parsing them
+ObjOffsets countObjVertices(const char* p, const char* end) {
+	ObjOffsets counts;
+	while (p < end) {
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+		if (!lineEnd) lineEnd = end;
+		p = skipSpaces(p, lineEnd);
+		size_t keyLength = skipToken(p, lineEnd) - p;
+		if (keyLength == 1 && p[0] == 'v') counts.positions++;
+		else if (keyLength == 2 && p[0] == 'v' && p[1] == 't') counts.texturePoints++;
+		else if (keyLength == 2 && p[0] == 'v' && p[1] == 'n') counts.normals++;
+		p = lineEnd + 1;
+	}
+	return counts;
+}
+
+// Parses the lines in [p, end) of an .obj file into mesh, tokenizing in place without copying any of it.
+// Understands v, vt, vn, f and usemtl, everything else (comments, groups, smoothing) is skipped.
+// Positions are multiplied by scalingFactor, material names are resolved to ids through materials.
+// Face indices are resolved as if offsets vertices of each kind had been read before p.
+void parseObjLines(const char* p, const char* end, float scalingFactor, const MaterialTable& materials, ObjMesh& mesh, int& material, ObjOffsets offsets = ObjOffsets()) {
+	vector<ObjCorner> face;
+	while (p < end) {
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+		if (!lineEnd) lineEnd = end;
+		p = skipSpaces(p, lineEnd);
+		const char* keyEnd = skipToken(p, lineEnd);
+		size_t keyLength = keyEnd - p;
+
+		// every vertex line is kept, even one with missing numbers, so face indices keep counting the lines of the file
+		if (keyLength == 1 && p[0] == 'v') {
+			vec3 position(0);
+			const char* q = keyEnd;
+			parseFloat(q, lineEnd, position.x) && parseFloat(q, lineEnd, position.y) && parseFloat(q, lineEnd, position.z);
+			mesh.positions.push_back(position * scalingFactor);
+		}
+		else if (keyLength == 2 && p[0] == 'v' && p[1] == 't') {
+			float u = 0, v = 0;
+			const char* q = keyEnd;
+			parseFloat(q, lineEnd, u) && parseFloat(q, lineEnd, v);
+			mesh.texturePoints.push_back(TexturePoint(u, v));
+		}
+		else if (keyLength == 2 && p[0] == 'v' && p[1] == 'n') {
+			vec3 normal(0);
+			const char* q = keyEnd;
+			parseFloat(q, lineEnd, normal.x) && parseFloat(q, lineEnd, normal.y) && parseFloat(q, lineEnd, normal.z);
+			mesh.normals.push_back(normal);
+		}
+		else if (keyLength == 1 && p[0] == 'f') {
+			face.clear();
+			const char* q = skipSpaces(keyEnd, lineEnd);
+			ObjCorner corner;
+			while (q < lineEnd && parseCorner(q, lineEnd, mesh, offsets, corner)) {
+				face.push_back(corner);
+				q = skipSpaces(q, lineEnd);
+			}
+			for (size_t k = 2; k < face.size(); k++) {
+				mesh.corners.push_back(face[0]);
+				mesh.corners.push_back(face[k - 1]);
+				mesh.corners.push_back(face[k]);
+				mesh.materials.push_back(material);
+			}
+		}
+		else if (keyLength == 6 && memcmp(p, "usemtl", 6) == 0) {
+			const char* name = skipSpaces(keyEnd, lineEnd);
+			material = materials.find(string(name, skipToken(name, lineEnd)));
+		}
+		p = lineEnd + 1;
+	}
+}
+
+// files smaller than this are parsed on the calling thread, splitting them costs more than it saves
+#define OBJ_CHUNK_SIZE (1 << 20)
+
+// Maps fileName and parses all of it, an unreadable file gives an empty mesh.
+// Large files are cut into newline aligned chunks parsed on the thread pool in two passes: the first counts the vertices
+// in every chunk so each one knows how many came before it (which negative and out of range indices depend on),
+// the second parses them. The chunks are then joined in file order, giving the same mesh as parsing it in one go.
+ObjMesh parseObjFile(const string& fileName, float scalingFactor, const MaterialTable& materials) {
+	ObjMesh mesh;
+	MappedFile file(fileName);
+	if (file.size() == 0) {
+		std::cout << "could not read " << fileName << std::endl;
+		return mesh;
+	}
+
+	int chunkCount = std::min<size_t>(threadPool.size() * 4, file.size() / OBJ_CHUNK_SIZE);
+	if (chunkCount <= 1) {
+		int material = 0;
+		parseObjLines(file.begin(), file.end(), scalingFactor, materials, mesh, material);
+		return mesh;
+	}
+
+	vector<const char*> boundaries(chunkCount + 1);
+	boundaries[0] = file.begin();
+	boundaries[chunkCount] = file.end();
+	for (int i = 1; i < chunkCount; i++) {
+		const char* p = file.begin() + file.size() * i / chunkCount;
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', file.end() - p));
+		boundaries[i] = std::max(boundaries[i - 1], lineEnd ? lineEnd + 1 : file.end());
+	}
+
+	vector<ObjOffsets> offsets(chunkCount + 1);
+	threadPool.parallelFor(chunkCount, [&](int i) {
+		offsets[i + 1] = countObjVertices(boundaries[i], boundaries[i + 1]);
+	});
+	for (int i = 1; i <= chunkCount; i++) {
+		offsets[i].positions += offsets[i - 1].positions;
+		offsets[i].texturePoints += offsets[i - 1].texturePoints;
+		offsets[i].normals += offsets[i - 1].normals;
+	}
+
+	// a chunk does not know which material is in use when it starts, -1 marks faces that carry on from the chunk before
+	vector<ObjMesh> chunks(chunkCount);
+	vector<int> lastMaterials(chunkCount, -1);
+	threadPool.parallelFor(chunkCount, [&](int i) {
+		parseObjLines(boundaries[i], boundaries[i + 1], scalingFactor, materials, chunks[i], lastMaterials[i], offsets[i]);
+	});
+
+	size_t triangleCount = 0;
+	for (const ObjMesh& chunk : chunks) triangleCount += chunk.materials.size();
+	mesh.positions.reserve(offsets[chunkCount].positions);
+	mesh.texturePoints.reserve(offsets[chunkCount].texturePoints);
+	mesh.normals.reserve(offsets[chunkCount].normals);
+	mesh.corners.reserve(3 * triangleCount);
+	mesh.materials.reserve(triangleCount);
+	int material = 0;
+	for (int i = 0; i < chunkCount; i++) {
+		ObjMesh& chunk = chunks[i];
+		mesh.positions.insert(mesh.positions.end(), chunk.positions.begin(), chunk.positions.end());
+		mesh.texturePoints.insert(mesh.texturePoints.end(), chunk.texturePoints.begin(), chunk.texturePoints.end());
+		mesh.normals.insert(mesh.normals.end(), chunk.normals.begin(), chunk.normals.end());
+		mesh.corners.insert(mesh.corners.end(), chunk.corners.begin(), chunk.corners.end());
+		for (int chunkMaterial : chunk.materials) mesh.materials.push_back(chunkMaterial == -1 ? material : chunkMaterial);
+		if (lastMaterials[i] != -1) material = lastMaterials[i];
+		chunk = ObjMesh();
+	}
+	return mesh;
+}
@@ -0,0 +1,182 @@
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <bitset>
+
+using namespace std;
+
+// Timers and counters for seeing where a frame's time goes, only compiled in when PROFILE is defined
+// (cmake -DPROFILE=ON, or make ... PROFILE=1), otherwise every PROFILE_ macro is empty and costs nothing.
+//
+// - PROFILE_FRAME(name) starts a new frame (dropping what the last one recorded) and times it, at the top of a render function
+// - PROFILE_SCOPE(name) times the rest of the enclosing block as one event, for stages that run a few thousand times a frame at most
+// - PROFILE_TIME(counter) adds the time the rest of the block takes to a counter, for things done per pixel or per ray
+//   where an event each would swamp the trace
+// - PROFILE_COUNT(counter, n) adds n to a counter
+//
+// Like the ray counts every thread records into its own buffers, so nothing is shared while rendering.
+// writeProfileTrace saves the last frame as Chrome trace event JSON (open it at chrome://tracing or ui.perfetto.dev).
+
+enum ProfileCounter {
+	COUNTER_PRIMARY_RAYS,
+	COUNTER_SHADOW_RAYS,
+	// mirror, metal and glass rays from checkMirror
+	COUNTER_SECONDARY_RAYS,
+	// ray against triangle tests, a packet testing a triangle counts one per ray
+	COUNTER_TRIANGLE_TESTS,
+	COUNTER_PIXELS_SHADED,
+	COUNTER_RASTER_TRIANGLES,
+	// pixels the rasterizer wrote, including ones later drawn over
+	COUNTER_FRAGMENTS,
+	// pixels something was drawn in at the end of the frame, fragments / covered is the overdraw
+	COUNTER_PIXELS_COVERED,
+	COUNTER_INTERSECT_NANOSECONDS,
+	COUNTER_SHADOW_NANOSECONDS,
+	COUNTER_REFLECTION_NANOSECONDS,
+	COUNTER_COUNT
+};
+
+const char* profileCounterNames[COUNTER_COUNT] = {
+	"primaryRays", "shadowRays", "secondaryRays", "triangleTests", "pixelsShaded", "rasterTriangles",
+	"fragments", "pixelsCovered", "intersectMs", "shadowMs", "reflectionMs"
+};
+
+#ifdef PROFILE
+
+typedef chrono::steady_clock::time_point ProfileTime;
+
+struct ProfileEvent {
+	const char* name;
+	ProfileTime start;
+	ProfileTime end;
+};
+
+struct ThreadProfile;
+
+// never freed, like the ray count registry, as the pool's workers remove themselves from it after globals are destroyed
+std::mutex& profileLock = *new std::mutex;
+vector<ThreadProfile*>& profiles = *new vector<ThreadProfile*>;
+// threads are numbered in the order they first record anything, numbers are never reused
+int nextProfileId = 0;
+// when the frame being recorded started, event times in the trace are relative to it
+ProfileTime profileFrameStart;
+
+struct ThreadProfile {
+	// only written by its own thread, and only read between frames
+	vector<ProfileEvent> events;
+	uint64_t counters[COUNTER_COUNT] = {};
+	int id;
+
+	ThreadProfile() {
+		// a frame has one event per tile or bin at most, so growing this is rare
+		events.reserve(4096);
+		lock_guard<std::mutex> guard(profileLock);
+		id = nextProfileId++;
+		profiles.push_back(this);
+	}
+
+	~ThreadProfile() {
+		lock_guard<std::mutex> guard(profileLock);
+		profiles.erase(std::find(profiles.begin(), profiles.end(), this));
+	}
+};
+
+thread_local ThreadProfile threadProfile;
+
+// records an event for its lifetime
+struct ProfileScope {
+	const char* name;
+	ProfileTime start;
+
+	ProfileScope(const char* scopeName) : name(scopeName), start(chrono::steady_clock::now()) {}
+
+	~ProfileScope() {
+		threadProfile.events.push_back({ name, start, chrono::steady_clock::now() });
+	}
+};
+
+// adds its lifetime in nanoseconds to a counter
+struct ProfileTimer {
+	ProfileCounter counter;
+	ProfileTime start;
+
+	ProfileTimer(ProfileCounter timerCounter) : counter(timerCounter), start(chrono::steady_clock::now()) {}
+
+	~ProfileTimer() {
+		threadProfile.counters[counter] += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+	}
+};
+
+// Throws away every thread's events and counters, called between frames while no other thread is rendering
+void beginProfileFrame() {
+	lock_guard<std::mutex> guard(profileLock);
+	for (ThreadProfile* profile : profiles) {
+		profile->events.clear();
+		std::fill(profile->counters, profile->counters + COUNTER_COUNT, 0);
+	}
+	profileFrameStart = chrono::steady_clock::now();
+}
+
+// a counter added up over every thread
+uint64_t profileTotal(ProfileCounter counter) {
+	lock_guard<std::mutex> guard(profileLock);
+	uint64_t total = 0;
+	for (ThreadProfile* profile : profiles) total += profile->counters[counter];
+	return total;
+}
+
+// the frame recorded since the last beginProfileFrame as Chrome trace event JSON, false if the file could not be written
+// every event is a complete ("X") event on the thread that ran it, and the counters are put on the frame's end as
+// counter ("C") events along with the overdraw
+bool writeProfileTrace(const string& fileName) {
+	ofstream file(fileName);
+	if (!file) return false;
+	auto microseconds = [](ProfileTime time) {
+		return chrono::duration<double, micro>(time - profileFrameStart).count();
+	};
+
+	lock_guard<std::mutex> guard(profileLock);
+	uint64_t totals[COUNTER_COUNT] = {};
+	ProfileTime frameEnd = profileFrameStart;
+	file << "{\"traceEvents\": [\n";
+	for (ThreadProfile* profile : profiles) {
+		for (const ProfileEvent& event : profile->events) {
+			file << "{\"name\": \"" << event.name << "\", \"cat\": \"render\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << profile->id
+				<< ", \"ts\": " << microseconds(event.start) << ", \"dur\": " << chrono::duration<double, micro>(event.end - event.start).count() << "},\n";
+			frameEnd = std::max(frameEnd, event.end);
+		}
+		for (int k = 0; k < COUNTER_COUNT; k++) totals[k] += profile->counters[k];
+	}
+	for (int k = 0; k < COUNTER_COUNT; k++) {
+		// the times are kept in nanoseconds but shown in milliseconds
+		bool time = k >= COUNTER_INTERSECT_NANOSECONDS;
+		file << "{\"name\": \"" << profileCounterNames[k] << "\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << microseconds(frameEnd)
+			<< ", \"args\": {\"value\": " << (time ? totals[k] / 1e6 : (double)totals[k]) << "}},\n";
+	}
+	double overdraw = totals[COUNTER_PIXELS_COVERED] == 0 ? 0 : (double)totals[COUNTER_FRAGMENTS] / totals[COUNTER_PIXELS_COVERED];
+	file << "{\"name\": \"overdraw\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << microseconds(frameEnd) << ", \"args\": {\"value\": " << overdraw << "}}\n";
+	file << "], \"displayTimeUnit\": \"ms\"}\n";
+	return bool(file);
+}
+
+// joins two tokens after expanding them, so every scope in a function gets a variable of its own
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_EXPANDED(a, b)
+#define PROFILE_JOIN_EXPANDED(a, b) a##b
+#define PROFILE_FRAME(name) beginProfileFrame(); ProfileScope PROFILE_JOIN(profileScope, __LINE__)(name)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(name)
+#define PROFILE_TIME(counter) ProfileTimer PROFILE_JOIN(profileTimer, __LINE__)(counter)
+#define PROFILE_COUNT(counter, n) (threadProfile.counters[counter] += (n))
+
+#else
+
+#define PROFILE_FRAME(name)
+#define PROFILE_SCOPE(name)
+#define PROFILE_TIME(counter)
+#define PROFILE_COUNT(counter, n)
+
+#endif
+
+// number of lanes set in a vmovemask result, for counting what a SIMD mask covered
+inline int maskCount(int mask) {
+	return (int)bitset<32>((unsigned)mask).count();
+}
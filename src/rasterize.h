@@ -1,310 +1,58 @@
 using namespace std;
 using namespace glm;
 
-#define WIDTH 640
-#define HEIGHT 480
+// the screen is split into bins this many pixels square (a multiple of RASTER_BLOCK), each rasterized by one thread
+#define RASTER_BIN 64
+// triangles are projected and set up in blocks of this many when spread over the thread pool
+#define RASTER_SETUP_BLOCK 1024
 
 uint32_t convertColour(Colour colour);
-vector<std::vector<uint32_t>> unloadTexture(TextureMap texture);
 vector<uint32_t> getColourMap(vector<float> t0, vector<float> t1, int steps, vector<vector<uint32_t>> sortedTexture);
-void drawTextureTriangle(DrawingWindow window, CanvasTriangle triangle, string filename);
-TexturePoint scaleTexturePoint(TextureMap texture, TexturePoint point);
+TexturePoint scaleTexturePoint(const TextureView& texture, TexturePoint point);
 
 
-vector<vector<float>> depthBuffer(WIDTH, std::vector<float>(HEIGHT, 0));
 
-// Finds equivalent vertex point on window 
-CanvasPoint getCanvasIntersectionPoint(glm::vec3 cameraPosition, glm::vec3 vertexPosition, float focalLength, float scale, mat3 cameraOrientation) {
+// Finds equivalent vertex point on a width by height window, without rounding it to a pixel
+CanvasPoint projectToCanvas(glm::vec3 cameraPosition, glm::vec3 vertexPosition, float focalLength, float scale, mat3 cameraOrientation, int width, int height) {
 	glm::vec3 correctedVertices = vertexPosition - cameraPosition;
 	correctedVertices = correctedVertices * cameraOrientation;
-	float u = (focalLength * (correctedVertices[0] / correctedVertices[2]) * -scale) + (WIDTH / 2);
-	float v = (focalLength * (correctedVertices[1] / correctedVertices[2]) * scale) + (HEIGHT / 2);
-	return CanvasPoint(round(u), round(v), correctedVertices[2]);
-}
-
-// designates maximum and minimum x values spanning all y values in a triangle
-// Inputs MUST be sorted in order of ascending y values
-vector<vector<float>> getxRanges(CanvasPoint p0, CanvasPoint p1, CanvasPoint p2, CanvasPoint p3) {
-	std::vector<float> xMins;
-	std::vector<float> xMaxs;
-	std::vector<float> xDepthMin;
-	std::vector<float> xDepthMax;
-
-	std::vector<std::vector<float>> top_to_left_edge = interpolateCoordinates(p0, p1, p2.y - p0.y);
-	std::vector<std::vector<float>> top_to_right_edge = interpolateCoordinates(p0, p2, p2.y - p0.y);
-
-	// Gets x value ranges for 'top' portion of triangle
-	for (int i = p0.y; i < p2.y; i++) {
-		xMins.push_back(top_to_left_edge[round(i - p0.y)][0]);
-		xMaxs.push_back(top_to_right_edge[round(i - p0.y)][0]);
-		xDepthMin.push_back(top_to_left_edge[round(i - p0.y)][2]);
-		xDepthMax.push_back(top_to_right_edge[round(i - p0.y)][2]);
-	}
-
-	std::vector<std::vector<float>> left_to_bot = interpolateCoordinates(p1, p3, p3.y - p2.y);
-	std::vector<std::vector<float>> right_to_bot = interpolateCoordinates(p2, p3, p3.y - p2.y);
-
-	// Gets x value ranges for 'bottom' portion of triangle
-	for (int i = p2.y; i < p3.y; i++) {
-		xMins.push_back(left_to_bot[round(i - p2.y)][0]);
-		xMaxs.push_back(right_to_bot[round(i - p2.y)][0]);
-		xDepthMin.push_back(left_to_bot[round(i - p2.y)][2]);
-		xDepthMax.push_back(right_to_bot[round(i - p2.y)][2]);
-	}
-	std::vector<std::vector<float>> allXs;
-
-	for (int i = 0; i < xMaxs.size(); i++) {
-		allXs.push_back({ xMins[i], xMaxs[i], xDepthMin[i], xDepthMax[i] });
-	}
-
-	return allXs;
+	float u = (focalLength * (correctedVertices[0] / correctedVertices[2]) * -scale) + (width / 2);
+	float v = (focalLength * (correctedVertices[1] / correctedVertices[2]) * scale) + (height / 2);
+	return CanvasPoint(u, v, correctedVertices[2]);
 }
 
-// Gets min and max coordinates of texture, for equivalent y coordinates in triangle
-vector<vector<vector<float>>> getInterpolatedRanges(vector<CanvasPoint> sorted) {
-	std::vector<std::vector<float>> leftCoordinate;
-	std::vector<std::vector<float>> rightCoordinate;
-
-	CanvasPoint t0(sorted[0].texturePoint.x, sorted[0].texturePoint.y);
-	CanvasPoint t1(sorted[1].texturePoint.x, sorted[1].texturePoint.y);
-	CanvasPoint t2(sorted[2].texturePoint.x, sorted[2].texturePoint.y);
-	CanvasPoint t3(sorted[3].texturePoint.x, sorted[3].texturePoint.y);
-
-	std::vector<std::vector<float>> top_to_left_tex = interpolateCoordinates(t0, t1, sorted[1].y - sorted[0].y);
-	std::vector<std::vector<float>> top_to_right_tex = interpolateCoordinates(t0, t2, sorted[1].y - sorted[0].y);
-
-	// Gets x value ranges for 'top' portion of triangle
-	for (int i = 0; i < sorted[1].y - sorted[0].y; i++) {
-		leftCoordinate.push_back({ top_to_left_tex[i][0], top_to_left_tex[i][1] });
-		rightCoordinate.push_back({ top_to_right_tex[i][0], top_to_right_tex[i][1] });
-	}
-
-	std::vector<std::vector<float>> left_to_bot_tex = interpolateCoordinates(t1, t3, sorted[3].y - sorted[1].y);
-	std::vector<std::vector<float>> right_to_bot_tex = interpolateCoordinates(t2, t3, sorted[3].y - sorted[1].y);
-
-	// Gets x value ranges for 'bottom' portion of triangle
-	for (int i = 0; i < sorted[3].y - sorted[1].y; i++) {
-		leftCoordinate.push_back({ left_to_bot_tex[i][0], left_to_bot_tex[i][1] });
-		rightCoordinate.push_back({ right_to_bot_tex[i][0], right_to_bot_tex[i][1] });
-	}
-	std::vector<std::vector<std::vector<float>>> allXs;
-
-	for (int i = 0; i < rightCoordinate.size(); i++) {
-		allXs.push_back({ leftCoordinate[i], rightCoordinate[i] });
-	}
-
-	return allXs;
-}
-
-// Sorts points according to y value (smallest to largest)
-// also creates 4th point which is opposite the 'middle' point
-vector<CanvasPoint> sortPoints(CanvasPoint v0, CanvasPoint v1, CanvasPoint v2) {
-	std::vector<CanvasPoint> sorted = { {v0.x, v0.y, v0.depth}, // top point
-										{v1.x, v1.y, v1.depth}, // middle point
-										{v2.x, v2.y, v2.depth}, // bottom point
-										{0, 0} };	  // opposite of middle point
-	sorted[0].texturePoint = v0.texturePoint;
-	sorted[1].texturePoint = v1.texturePoint;
-	sorted[2].texturePoint = v2.texturePoint;
-
-	// order by y coordinates
-	if (sorted[1].y < sorted[0].y) { std::swap(sorted[0], sorted[1]); }
-	if (sorted[2].y < sorted[1].y) { std::swap(sorted[1], sorted[2]); }
-	if (sorted[1].y < sorted[0].y) { std::swap(sorted[0], sorted[1]); }
-
-	// sets middle point's opposite y value to be the same
-	sorted[3].y = sorted[1].y;
-	sorted[3].x = sorted[2].x;
-	sorted[3].depth = sorted[1].depth;
-	// placeholder for texture 
-	sorted[3].texturePoint = TexturePoint(-1, -1);
-
-	std::vector<std::vector<float>> longEdge = interpolateCoordinates(sorted[0], sorted[2], sorted[2].y - sorted[0].y);
-
-	// Gets vertex opposite of middle corner
-	for (int i = 0; i < longEdge.size(); i++) {
-		if (longEdge[i][1] == sorted[1].y) {
-			sorted[3].x = round(longEdge[i][0]);
-			sorted[3].depth = longEdge[i][2];
-		}
-	}
-
-	return sorted;
-}
-
-// Draws filled triangle taking into account depth buffer
-void drawFilledTriangle(DrawingWindow& window, CanvasTriangle triangle, Colour colour) {
-	// Creates a template structure for storing all points which will be sorted
-	std::vector<CanvasPoint> sorted = sortPoints(triangle.v0(), triangle.v1(), triangle.v2());
-
-	// Leftmost point deemed by sorted[1], rightmost deemed by sorted[2]
-	if (sorted[1].x > sorted[3].x) {
-		std::swap(sorted[1], sorted[3]);
-		std::swap(sorted[2], sorted[3]);
-	}
-	else { std::swap(sorted[2], sorted[3]); }
-	std::vector<std::vector<float>> xRange = getxRanges(sorted[0], sorted[1], sorted[2], sorted[3]);
-
-	// Draws triangle by iterating through y and then only drawing if x values are in particular range given the y (marked)
-	for (int y = sorted[0].y; y < sorted[3].y; y++) {
-		float first = xRange[y - sorted[0].y][0]; // beginning of x range
-		float second = xRange[y - sorted[0].y][1]; // end of x range
-		std::vector<float> depthPoints = interpolateSingleFloats(xRange[y - sorted[0].y][2], xRange[y - sorted[0].y][3], second - first + 1);
-		for (int x = first; x <= second; x++) {
-			float s = 1 / abs(depthPoints[x - first]);
-			if ((x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT) && s > depthBuffer[x][y]) {
-				window.setPixelColour(x, y, convertColour(colour));
-				depthBuffer[x][y] = s;
-			}
-		}
-	}
-}
-
-void drawTopTriangle(DrawingWindow& window, vector<CanvasPoint> points, vector<std::vector<uint32_t>> texture) {
-	int rows = points[2].y - points[0].y;
-	CanvasPoint texture0 = CanvasPoint(points[0].texturePoint.x, points[0].texturePoint.y);
-	CanvasPoint texture1 = CanvasPoint(points[1].texturePoint.x, points[1].texturePoint.y);
-	CanvasPoint texture2 = CanvasPoint(points[2].texturePoint.x, points[2].texturePoint.y);
-
-	vector<float> topToBot = interpolateSingleFloats(points[0].x, points[1].x, rows);
-	vector<vector<float>> textureTopToBot = interpolateCoordinates(texture0, texture1, rows);
-	
-	vector<float> topToMid = interpolateSingleFloats(points[0].x, points[2].x, rows);
-	vector<vector<float>> textureTopToMid = interpolateCoordinates(texture0, texture2, rows);
-	int textureSize = texture.size() - 1;
-
-	for (int y = 0; y < rows; y++) {
-		int rowPixels = topToMid[y] - topToBot[y];
-		CanvasPoint t0(textureTopToBot[y][0], textureTopToBot[y][1]);
-		CanvasPoint t1(textureTopToMid[y][0], textureTopToMid[y][1]);
-
-
-		if (rowPixels < 0) {
-			rowPixels = abs(rowPixels);
-			vector<vector<float>> textureScaled = interpolateCoordinates(t0, t1, rowPixels);
-
-			for (int x = 0; x < rowPixels; x++) {
-				int a = round(textureScaled[x][0]);
-				int b = round(textureScaled[x][1]);
-
-
-				a = clamp(a, 0, textureSize);
-				b = clamp(b, 0, textureSize);
-
-				uint32_t colour = texture[b][a];
-				int xValue = topToBot[y] - x;
-				int yValue = points[0].y + y;
-				if (xValue < WIDTH && xValue > 0 && yValue < HEIGHT && yValue > 0) window.setPixelColour(xValue, yValue, colour);
-			}
-		}
-		else {
-			vector<vector<float>> textureScaled = interpolateCoordinates(t0, t1, rowPixels);
-
-			for (int x = 0; x < rowPixels; x++) {
-				int a = round(textureScaled[x][0]);
-				int b = round(textureScaled[x][1]);
-
-				a = clamp(a, 0, textureSize);
-				b = clamp(b, 0, textureSize);
-
-				uint32_t colour = texture[b][a];
-				int xValue = topToBot[y] + x;
-				int yValue = points[0].y + y;
-				if (xValue < WIDTH && xValue > 0 && yValue < HEIGHT && yValue > 0) window.setPixelColour(xValue, yValue, colour);
-			}
-		}
-	}
+// Finds equivalent vertex point on window 
+CanvasPoint getCanvasIntersectionPoint(glm::vec3 cameraPosition, glm::vec3 vertexPosition, float focalLength, float scale, mat3 cameraOrientation, int width, int height) {
+	CanvasPoint point = projectToCanvas(cameraPosition, vertexPosition, focalLength, scale, cameraOrientation, width, height);
+	return CanvasPoint(round(point.x), round(point.y), point.depth);
 }
 
-void drawBotTriangle(DrawingWindow& window, vector<CanvasPoint> points, vector<vector<uint32_t>> texture) {
-	int rows = points[2].y - points[0].y;
-
-	CanvasPoint texture0 = CanvasPoint(points[0].texturePoint.x, points[0].texturePoint.y);
-	CanvasPoint texture1 = CanvasPoint(points[1].texturePoint.x, points[1].texturePoint.y);
-	CanvasPoint texture2 = CanvasPoint(points[2].texturePoint.x, points[2].texturePoint.y);
-
-	vector<float> topToBot = interpolateSingleFloats(points[0].x, points[2].x, rows);
-	vector<vector<float>> textureTopToBot = interpolateCoordinates(texture0, texture2, rows);
-
-	vector<float> topToMid = interpolateSingleFloats(points[1].x, points[2].x, rows);
-	vector<vector<float>> textureTopToMid = interpolateCoordinates(texture1, texture2, rows);
-	int textureSize = texture.size() - 1;
-
-	for (int y = 0; y < rows; y++) {
-		int rowPixels = topToMid[y] - topToBot[y];
-
-		CanvasPoint t0(textureTopToBot[y][0], textureTopToBot[y][1]);
-		CanvasPoint t1(textureTopToMid[y][0], textureTopToMid[y][1]);
-
-		if (rowPixels < 0) {
-			rowPixels = abs(rowPixels);
-			vector<vector<float>> textureScaled = interpolateCoordinates(t0, t1, rowPixels);
-			for (int x = 0; x < rowPixels; x++) {
-				int a = round(textureScaled[x][0]);
-				int b = round(textureScaled[x][1]);
-
-				a = clamp(a, 0, textureSize);
-				b = clamp(b, 0, textureSize);
-
-				uint32_t colour = texture[b][a];
-				int xValue = topToBot[y] - x;
-				int yValue = points[0].y + y;
-				if (xValue < WIDTH && xValue > 0 && yValue < HEIGHT && yValue > 0) window.setPixelColour(xValue, yValue, colour);
-			}
-		}
-		else {
-			vector<vector<float>> textureScaled = interpolateCoordinates(t0, t1, rowPixels);
-			for (int x = 0; x < rowPixels; x++) {
-				int a = round(textureScaled[x][0]);
-				int b = round(textureScaled[x][1]);
-
-				a = clamp(a, 0, textureSize);
-				b = clamp(b, 0, textureSize);
-
-				uint32_t colour = texture[b][a];
-				int xValue = topToBot[y] + x;
-				int yValue = points[0].y + y;
-				if (xValue < WIDTH && xValue > 0 && yValue < HEIGHT && yValue > 0) window.setPixelColour(xValue, yValue, colour);
-			}
-		}
+// projects every vertex of mesh once into points, so triangles sharing a vertex do not each transform it again
+// subpixel keeps the exact positions for the edge function rasterizer instead of rounding them to pixels
+void projectVertices(const Mesh& mesh, glm::vec3 cameraPosition, float focalLength, float scale, mat3 cameraOrientation, int width, int height, vector<CanvasPoint>& points, bool subpixel = false) {
+	PROFILE_SCOPE("project vertices");
+	points.resize(mesh.positions.size());
+	for (size_t i = 0; i < points.size(); i++) {
+		if (subpixel) points[i] = projectToCanvas(cameraPosition, mesh.positions[i], focalLength, scale, cameraOrientation, width, height);
+		else points[i] = getCanvasIntersectionPoint(cameraPosition, mesh.positions[i], focalLength, scale, cameraOrientation, width, height);
 	}
 }
 
-
-void drawTexturedTriangle(DrawingWindow& window, CanvasTriangle triangle, TextureMap texture) {
-	vector<std::vector<uint32_t>> sortedTexture = unloadTexture(texture);
-
-	// sorted[0-2] of ascending y values, sorted[3] is always the midpoint
-	vector<CanvasPoint> sorted = sortPoints(triangle.vertices[0], triangle.vertices[1], triangle.vertices[2]);
-	float a0 = sorted[0].x - sorted[2].x; 
-	float b0 = sorted[0].y - sorted[2].y;
-	float a1 = sorted[0].x - sorted[3].x; 
-	float b1 = sorted[0].y - sorted[3].y;
-
-	// get proportion to mid point to calculate midpoint on texture
-	float topToBot = sqrt(a0*a0 + b0*b0);
-	float topToMid = sqrt(a1*a1 + b1*b1);
-	float midProportion = topToMid / topToBot;
-
-	// calculate equivalent midpoint on texture
-	sorted[3].texturePoint.x = round(((sorted[2].texturePoint.x - sorted[0].texturePoint.x) * midProportion) + sorted[0].texturePoint.x);
-	sorted[3].texturePoint.y = round(((sorted[2].texturePoint.y - sorted[0].texturePoint.y) * midProportion) + sorted[0].texturePoint.y);
-
-	vector<CanvasPoint> topTriangle = { sorted[0], sorted[1], sorted[3] };
-	vector<CanvasPoint> botTriangle = { sorted[1], sorted[3], sorted[2] };
-
-	drawTopTriangle(window, topTriangle, sortedTexture);
-	drawBotTriangle(window, botTriangle, sortedTexture);
+// Draws filled triangle taking into account depth buffer, which is sized to window first
+void drawFilledTriangle(FrameBuffer& window, DepthBuffer& depthBuffer, CanvasTriangle triangle, Colour colour) {
+	depthBuffer.match(window);
+	RasterTriangle setup;
+	if (!setupRasterTriangle(triangle.v0(), triangle.v1(), triangle.v2(), depthBuffer.width, depthBuffer.height, setup)) return;
+	rasterizeTriangle(setup, FlatShade{ convertColour(colour) }, window.getPixelBuffer(), window.width, depthBuffer);
 }
 
-
-// Generates a triangle with random vertices in the form CanvasTriangle
-CanvasTriangle generateRandomTriangle() {
+// Generates a triangle with random vertices on a width by height window in the form CanvasTriangle
+CanvasTriangle generateRandomTriangle(int width, int height) {
 	std::vector<float> widths;  // avoids casting when initializing structures
 	std::vector<float> heights;
 	for (int i = 0; i < 3; i++) {
-		widths.push_back(rand() % WIDTH);
-		heights.push_back(rand() % HEIGHT);
+		widths.push_back(rand() % width);
+		heights.push_back(rand() % height);
 	}
 	CanvasTriangle triangle{ CanvasPoint{widths[0], heights[0]},
 							 CanvasPoint{widths[1], heights[1]},
@@ -313,30 +61,98 @@ CanvasTriangle generateRandomTriangle() {
 	return triangle;
 }
 
-void randomFilledTriangle(DrawingWindow& window) {
-	drawFilledTriangle(window, generateRandomTriangle(), Colour{ rand() % 256, rand() % 256, rand() % 256 });
+void randomFilledTriangle(FrameBuffer& window, DepthBuffer& depthBuffer) {
+	drawFilledTriangle(window, depthBuffer, generateRandomTriangle(window.width, window.height), Colour{ rand() % 256, rand() % 256, rand() % 256 });
 }
 
+// What renderRasterizedScene does with each triangle of the mesh, worked out before any are drawn
+enum RasterKind : uint8_t { RASTER_SKIP, RASTER_FILLED, RASTER_TEXTURED };
+
 // renders scene using rasterization
-void renderRasterizedScene(DrawingWindow& window, vector<ModelTriangle> triangles, vec3 cameraPos, float focalLength, float scaleFactor, mat3 cameraOrientation) {
+// Triangles are projected and set up in parallel, then binned: each RASTER_BIN square of the screen gets the list of
+// triangles whose bounding box touches it, in mesh order. The bins are drawn in parallel, each into a depth buffer of
+// its own the size of the bin (which stays in cache) that is written back to depthBuffer at the end. Every pixel sees
+// the same triangles in the same order as drawing them one after another, so the picture is exactly the same.
+void renderRasterizedScene(FrameBuffer& window, DepthBuffer& depthBuffer, const Scene& scene, vec3 cameraPos, float focalLength, float scaleFactor, mat3 cameraOrientation) {
+	PROFILE_FRAME("raster frame");
+	const Mesh& mesh = scene.mesh;
+	int triangleCount = mesh.triangleCount();
+	int width = window.width;
+	int height = window.height;
+	static vector<CanvasPoint> projected;
+	static vector<RasterTriangle> setups;
+	static vector<uint32_t> colours;
+	static vector<TextureShade> textures;
+	static vector<RasterKind> kinds;
+	static vector<vector<int>> bins;
+	projectVertices(mesh, cameraPos, focalLength, scaleFactor, cameraOrientation, width, height, projected, true);
 	window.clearPixels();
-	
-	for (int i = 0; i < triangles.size(); i++) {
-		CanvasPoint pos0 = getCanvasIntersectionPoint(cameraPos, triangles[i].vertices[0], focalLength, scaleFactor, cameraOrientation);
-		CanvasPoint pos1 = getCanvasIntersectionPoint(cameraPos, triangles[i].vertices[1], focalLength, scaleFactor, cameraOrientation);
-		CanvasPoint pos2 = getCanvasIntersectionPoint(cameraPos, triangles[i].vertices[2], focalLength, scaleFactor, cameraOrientation);
-		if (triangles[i].colour.texture == false) {
-			drawFilledTriangle(window, CanvasTriangle(pos0, pos1, pos2), triangles[i].colour);
+	depthBuffer.match(window);
+
+	setups.resize(triangleCount);
+	colours.resize(triangleCount);
+	textures.resize(triangleCount);
+	kinds.resize(triangleCount);
+	threadPool.parallelFor((triangleCount + RASTER_SETUP_BLOCK - 1) / RASTER_SETUP_BLOCK, [&](int block) {
+		PROFILE_SCOPE("triangle setup");
+		int end = std::min(triangleCount, (block + 1) * RASTER_SETUP_BLOCK);
+		for (int i = block * RASTER_SETUP_BLOCK; i < end; i++) {
+			const uint32_t* corners = &mesh.indices[3 * i];
+			CanvasPoint points[3];
+			for (int k = 0; k < 3; k++) points[k] = projected[corners[k]];
+			kinds[i] = RASTER_SKIP;
+			// there is no near plane clipping, a triangle reaching behind the camera would project inside out
+			if (points[0].depth >= 0 || points[1].depth >= 0 || points[2].depth >= 0) continue;
+			Colour colour = mesh.colour(i, scene.materials);
+			// faces with texture coordinates use their material's texture, or the scene's first one if the material has none
+			TextureView texture;
+			if (colour.texture == true) {
+				const Material& material = scene.materials[mesh.materials[i]];
+				texture = scene.textures.view(material.texture);
+				if (texture.empty()) texture = scene.textures.view(0);
+				textures[i].texture = texture;
+				textures[i].wrap = material.textureWrap;
+			}
+			if (texture.empty()) {
+				if (setupRasterTriangle(points[0], points[1], points[2], width, height, setups[i])) kinds[i] = RASTER_FILLED;
+				colours[i] = convertColour(colour);
+			}
+			else {
+				for (int k = 0; k < 3; k++) points[k].texturePoint = scaleTexturePoint(texture, mesh.texturePoints[corners[k]]);
+				if (setupRasterTriangle(points[0], points[1], points[2], width, height, setups[i], &textures[i])) kinds[i] = RASTER_TEXTURED;
+			}
+			PROFILE_COUNT(COUNTER_RASTER_TRIANGLES, kinds[i] != RASTER_SKIP);
 		}
-		//else if (triangles[i].colour.texture == true) {
-		else if (triangles[i].colour.texture == true) {
-			TextureMap texture = TextureMap("logo_texture.ppm");
-			pos0.texturePoint = scaleTexturePoint(texture, triangles[i].texturePoints[0]);
-			pos1.texturePoint = scaleTexturePoint(texture, triangles[i].texturePoints[1]);
-			pos2.texturePoint = scaleTexturePoint(texture, triangles[i].texturePoints[2]);
-			drawTexturedTriangle(window, CanvasTriangle(pos0, pos1, pos2), texture);
+	});
+
+	int binsX = (width + RASTER_BIN - 1) / RASTER_BIN;
+	int binsY = (height + RASTER_BIN - 1) / RASTER_BIN;
+	bins.resize(binsX * binsY);
+	for (vector<int>& bin : bins) bin.clear();
+	{
+		PROFILE_SCOPE("binning");
+		for (int i = 0; i < triangleCount; i++) {
+			if (kinds[i] == RASTER_SKIP) continue;
+			const RasterTriangle& setup = setups[i];
+			for (int binY = setup.minY / RASTER_BIN; binY <= setup.maxY / RASTER_BIN; binY++) {
+				for (int binX = setup.minX / RASTER_BIN; binX <= setup.maxX / RASTER_BIN; binX++) bins[binX + binY * binsX].push_back(i);
+			}
 		}
 	}
-	
-	depthBuffer = vector<vector<float>>(WIDTH, std::vector<float>(HEIGHT, 0));
+
+	uint32_t* pixels = window.getPixelBuffer();
+	threadPool.parallelFor(binsX * binsY, [&](int b) {
+		PROFILE_SCOPE("rasterize bin");
+		thread_local DepthBuffer binDepth;
+		binDepth.originX = b % binsX * RASTER_BIN;
+		binDepth.originY = b / binsX * RASTER_BIN;
+		binDepth.resize(std::min(RASTER_BIN, width - binDepth.originX), std::min(RASTER_BIN, height - binDepth.originY));
+		binDepth.clear();
+		for (int i : bins[b]) {
+			if (kinds[i] == RASTER_TEXTURED) rasterizeTriangle(setups[i], textures[i], pixels, width, binDepth);
+			else rasterizeTriangle(setups[i], FlatShade{ colours[i] }, pixels, width, binDepth);
+		}
+		PROFILE_COUNT(COUNTER_PIXELS_COVERED, std::count_if(binDepth.depths.begin(), binDepth.depths.end(), [](float inverseDepth) { return inverseDepth != 0; }));
+		binDepth.storeInto(depthBuffer);
+	});
 }
@@ -0,0 +1,51 @@
+#include <atomic>
+#include <mutex>
+
+using namespace std;
+
+// Every ray the ray tracer casts is counted by the thread casting it, so counting never makes threads wait on each other
+// or fight over a cache line. totalRaysCast adds up the counts of every thread that has cast any.
+struct ThreadRayCount;
+
+// Never freed: globals are destroyed before the thread pool joins its workers at exit, and each worker's count
+// still takes the lock and removes itself from the list as it goes
+std::mutex& rayCountLock = *new std::mutex;
+// room reserved up front so a thread casting its first ray doesn't allocate in the middle of a frame
+vector<ThreadRayCount*>& rayCounts = *[] {
+	vector<ThreadRayCount*>* counts = new vector<ThreadRayCount*>;
+	counts->reserve(256);
+	return counts;
+}();
+// rays cast by threads that have since exited
+uint64_t retiredRays = 0;
+
+struct ThreadRayCount {
+	// only ever written by its own thread, atomic so another thread can read it at any time
+	std::atomic<uint64_t> rays{ 0 };
+
+	ThreadRayCount() {
+		lock_guard<std::mutex> guard(rayCountLock);
+		rayCounts.push_back(this);
+	}
+
+	~ThreadRayCount() {
+		lock_guard<std::mutex> guard(rayCountLock);
+		retiredRays += rays.load(memory_order_relaxed);
+		rayCounts.erase(std::find(rayCounts.begin(), rayCounts.end(), this));
+	}
+};
+
+thread_local ThreadRayCount threadRayCount;
+
+inline void countRays(int count) {
+	// a plain load and store rather than fetch_add, nothing else writes this counter so no locked instruction is needed
+	threadRayCount.rays.store(threadRayCount.rays.load(memory_order_relaxed) + count, memory_order_relaxed);
+}
+
+// rays cast so far by all threads, take the difference of two calls to count the rays of a frame
+uint64_t totalRaysCast() {
+	lock_guard<std::mutex> guard(rayCountLock);
+	uint64_t total = retiredRays;
+	for (ThreadRayCount* count : rayCounts) total += count->rays.load(memory_order_relaxed);
+	return total;
+}
@@ -1,79 +1,447 @@
 using namespace std;
 using namespace glm;
 
-#define WIDTH 640
-#define HEIGHT 480
-
-// Finds closest triangle that intersects 
-RayTriangleIntersection getClosestIntersection(glm::vec3 source, glm::vec3 rayDirection, vector<ModelTriangle> triangles, int triangleIndex = -1, int material=-1) {
-	RayTriangleIntersection currentClosest;
-	currentClosest.distanceFromCamera = numeric_limits<float>::max();
-
-	for (int i = 0; i < triangles.size(); i++) {
-		glm::vec3 e0 = triangles[i].vertices[1] - triangles[i].vertices[0];
-		glm::vec3 e1 = triangles[i].vertices[2] - triangles[i].vertices[0];
-		glm::vec3 SPVector = source - triangles[i].vertices[0];
-		glm::mat3 DEMatrix(-rayDirection, e0, e1);
-		glm::vec3 possibleSolution = glm::inverse(DEMatrix) * SPVector;
-
-		float t = possibleSolution[0];
-		float u = possibleSolution[1];
-		float v = possibleSolution[2];
-
-		if ((u >= 0.0) && (u <= 1.0) && (v >= 0.0) && (v <= 1.0) && (u + v) <= 1.0) {
+#define TILE_SIZE 16
+
+// Moller-Trumbore test against triangle j of the geometry store, distance is checked first so most misses exit before u and v are worked out
+// u and v are the same barycentrics as solving [-rayDirection, e0, e1] * (t, u, v) = source - v0
+bool intersectTriangle(const TriangleGeometry& geometry, int j, glm::vec3 source, glm::vec3 rayDirection, float maxDistance, float& t, float& u, float& v) {
+	float det = -((rayDirection.x * geometry.normalX[j] + rayDirection.y * geometry.normalY[j]) + rayDirection.z * geometry.normalZ[j]);
+	if (det == 0) return false;
+	float inverseDet = 1.0f / det;
+
+	glm::vec3 SPVector = source - geometry.v0(j);
+	t = ((SPVector.x * geometry.normalX[j] + SPVector.y * geometry.normalY[j]) + SPVector.z * geometry.normalZ[j]) * inverseDet;
+	if (!(t > 0 && t < maxDistance)) return false;
+
+	glm::vec3 q = cross(SPVector, rayDirection);
+	u = ((geometry.e1x[j] * q.x + geometry.e1y[j] * q.y) + geometry.e1z[j] * q.z) * inverseDet;
+	if (u < 0.0 || u > 1.0) return false;
+	v = -((geometry.e0x[j] * q.x + geometry.e0y[j] * q.y) + geometry.e0z[j] * q.z) * inverseDet;
+	return v >= 0.0 && v <= 1.0 && (u + v) <= 1.0;
+}
+
+// Finds closest triangle that intersects, only testing triangles in bounding boxes the ray passes through
+// triangles with surface type skipSurface (SURFACE_METAL etc) are ignored, -1 ignores none
+HitRecord findClosestHit(glm::vec3 source, glm::vec3 rayDirection, const Scene& scene, int triangleIndex, int skipSurface) {
+	const BVH& bvh = scene.bvh;
+	const TriangleGeometry& geometry = scene.geometry;
+	HitRecord closest;
+	countRays(1);
+	if (bvh.nodes.empty()) return closest;
+
+	glm::vec3 inverseDirection = safeInverse(rayDirection);
+	int stack[BVH_MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const BVHNode& node = bvh.nodes[stack[--stackSize]];
+		if (intersectBox(node.bounds, source, inverseDirection, closest.distance) == numeric_limits<float>::max()) continue;
+
+		if (node.count == 0) {
+			// visit nearer child first so closer hits shrink the search for the other one
+			float leftDistance = intersectBox(bvh.nodes[node.leftFirst].bounds, source, inverseDirection, closest.distance);
+			float rightDistance = intersectBox(bvh.nodes[node.leftFirst + 1].bounds, source, inverseDirection, closest.distance);
+			if (leftDistance < rightDistance) {
+				stack[stackSize++] = node.leftFirst + 1;
+				stack[stackSize++] = node.leftFirst;
+			}
+			else {
+				stack[stackSize++] = node.leftFirst;
+				stack[stackSize++] = node.leftFirst + 1;
+			}
+			continue;
+		}
+
+		PROFILE_COUNT(COUNTER_TRIANGLE_TESTS, node.count);
+		for (int j = node.leftFirst; j < node.leftFirst + node.count; j++) {
+			float t, u, v;
+			if (!intersectTriangle(geometry, j, source, rayDirection, closest.distance, t, u, v)) continue;
+
 			// skips checking for triangle i if triangleIndex is specified
-			if (t < currentClosest.distanceFromCamera && t > 0 && triangleIndex != i && triangles[i].material != material) {
-				currentClosest.distanceFromCamera = t;
-				currentClosest.intersectedTriangle = triangles[i];
-				currentClosest.triangleIndex = i;
-				currentClosest.intersectionPoint = glm::vec3(triangles[i].vertices[0] + (u * e0) + (v * e1));
-				currentClosest.u = u;
-				currentClosest.v = v;
+			if (triangleIndex != bvh.triangleIndices[j] && geometry.surface[j] != skipSurface) {
+				closest.distance = t;
+				closest.u = u;
+				closest.v = v;
+				closest.triangle = j;
+			}
+		}
+	}
+	return closest;
+}
+
+// turns a hit into the full intersection the lighting functions work with, done once per ray after the search is over
+RayTriangleIntersection resolveHit(const HitRecord& hit, const Scene& scene) {
+	RayTriangleIntersection intersection;
+	intersection.distanceFromCamera = hit.distance;
+	if (hit.triangle == -1) return intersection;
+
+	int i = scene.bvh.triangleIndices[hit.triangle];
+	intersection.intersectedTriangle = scene.mesh.triangle(i, scene.materials);
+	intersection.triangleIndex = i;
+	intersection.intersectionPoint = scene.geometry.pointAt(hit.triangle, hit.u, hit.v);
+	intersection.u = hit.u;
+	intersection.v = hit.v;
+	return intersection;
+}
+
+// Any-hit query for shadow rays, true as soon as some triangle other than triangleIndex lies within maxDistance.
+// Which blocker is closest does not matter, so children are not ordered and the walk stops at the first one found.
+bool occluded(glm::vec3 source, glm::vec3 rayDirection, float maxDistance, const Scene& scene, int triangleIndex = -1) {
+	const BVH& bvh = scene.bvh;
+	const TriangleGeometry& geometry = scene.geometry;
+	countRays(1);
+	PROFILE_COUNT(COUNTER_SHADOW_RAYS, 1);
+	if (bvh.nodes.empty()) return false;
+
+	glm::vec3 inverseDirection = safeInverse(rayDirection);
+	int stack[BVH_MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const BVHNode& node = bvh.nodes[stack[--stackSize]];
+		if (intersectBox(node.bounds, source, inverseDirection, maxDistance) == numeric_limits<float>::max()) continue;
+
+		if (node.count == 0) {
+			stack[stackSize++] = node.leftFirst;
+			stack[stackSize++] = node.leftFirst + 1;
+			continue;
+		}
+
+		for (int j = node.leftFirst; j < node.leftFirst + node.count; j++) {
+			float t, u, v;
+			PROFILE_COUNT(COUNTER_TRIANGLE_TESTS, 1);
+			if (intersectTriangle(geometry, j, source, rayDirection, maxDistance, t, u, v) && bvh.triangleIndices[j] != triangleIndex) return true;
+		}
+	}
+	return false;
+}
+
+// primary rays are traced in small blocks, 4x2 pixels with AVX2 or 2x2 with SSE, one ray per SIMD lane
+#define PACKET_WIDTH (SIMD_WIDTH / 2)
+#define PACKET_HEIGHT 2
+
+// closest hit of every ray in a packet, triangle is the position in bvh.triangleIndices or -1 if the ray missed
+struct PacketHit {
+	float distance[SIMD_WIDTH];
+	float u[SIMD_WIDTH];
+	float v[SIMD_WIDTH];
+	int triangle[SIMD_WIDTH];
+};
+
+// Same walk and the same Moller-Trumbore arithmetic as findClosestHit, but for a packet of coherent rays
+// sharing one origin, each triangle and box is tested against every ray at once.
+// A node is visited while any ray in the packet still hits its box.
+// The rays are counted by the callers, which know how many of them are for pixels inside the image.
+void getClosestIntersections(glm::vec3 source, const glm::vec3* rayDirections, const Scene& scene, PacketHit& hit) {
+	const BVH& bvh = scene.bvh;
+	const TriangleGeometry& geometry = scene.geometry;
+	float lanes[3][SIMD_WIDTH];
+	float inverseLanes[3][SIMD_WIDTH];
+	for (int k = 0; k < SIMD_WIDTH; k++) {
+		glm::vec3 inverseDirection = safeInverse(rayDirections[k]);
+		for (int axis = 0; axis < 3; axis++) {
+			lanes[axis][k] = rayDirections[k][axis];
+			inverseLanes[axis][k] = inverseDirection[axis];
+		}
+		hit.triangle[k] = -1;
+	}
+	vfloat directionX = vfloat::load(lanes[0]), directionY = vfloat::load(lanes[1]), directionZ = vfloat::load(lanes[2]);
+	vfloat inverseX = vfloat::load(inverseLanes[0]), inverseY = vfloat::load(inverseLanes[1]), inverseZ = vfloat::load(inverseLanes[2]);
+	vfloat closest(numeric_limits<float>::max());
+	vfloat closestU(0.0f), closestV(0.0f);
+	if (bvh.nodes.empty()) {
+		closest.store(hit.distance);
+		return;
+	}
+
+	int stack[BVH_MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const BVHNode& node = bvh.nodes[stack[--stackSize]];
+		const AABB& box = node.bounds;
+		vfloat t0 = vfloat(box.minimum.x - source.x) * inverseX, t1 = vfloat(box.maximum.x - source.x) * inverseX;
+		vfloat entry = vmin(t0, t1), exit = vmax(t0, t1);
+		t0 = vfloat(box.minimum.y - source.y) * inverseY;
+		t1 = vfloat(box.maximum.y - source.y) * inverseY;
+		entry = vmax(entry, vmin(t0, t1));
+		exit = vmin(exit, vmax(t0, t1));
+		t0 = vfloat(box.minimum.z - source.z) * inverseZ;
+		t1 = vfloat(box.maximum.z - source.z) * inverseZ;
+		entry = vmax(entry, vmin(t0, t1));
+		exit = vmin(exit, vmax(t0, t1));
+		if (vmovemask((exit >= entry) & (exit > vfloat(0.0f)) & (entry < closest)) == 0) continue;
 
+		if (node.count == 0) {
+			// order children by how far their centres are along the first ray, packets are coherent so it suits them all
+			glm::vec3 firstDirection = rayDirections[0];
+			const AABB& left = bvh.nodes[node.leftFirst].bounds;
+			const AABB& right = bvh.nodes[node.leftFirst + 1].bounds;
+			float leftDistance = dot((left.minimum + left.maximum) * 0.5f - source, firstDirection);
+			float rightDistance = dot((right.minimum + right.maximum) * 0.5f - source, firstDirection);
+			if (leftDistance < rightDistance) {
+				stack[stackSize++] = node.leftFirst + 1;
+				stack[stackSize++] = node.leftFirst;
 			}
+			else {
+				stack[stackSize++] = node.leftFirst;
+				stack[stackSize++] = node.leftFirst + 1;
+			}
+			continue;
+		}
+
+		PROFILE_COUNT(COUNTER_TRIANGLE_TESTS, node.count * SIMD_WIDTH);
+		for (int j = node.leftFirst; j < node.leftFirst + node.count; j++) {
+			vfloat normalX(geometry.normalX[j]), normalY(geometry.normalY[j]), normalZ(geometry.normalZ[j]);
+			vfloat det = -((directionX * normalX + directionY * normalY) + directionZ * normalZ);
+			vfloat inverseDet = vfloat(1.0f) / det;
+
+			// the origin is shared so everything that only depends on it and the triangle stays scalar
+			glm::vec3 SPVector = source - geometry.v0(j);
+			vfloat t = vfloat((SPVector.x * geometry.normalX[j] + SPVector.y * geometry.normalY[j]) + SPVector.z * geometry.normalZ[j]) * inverseDet;
+			vfloat mask = (det != vfloat(0.0f)) & (t > vfloat(0.0f)) & (t < closest);
+			if (vmovemask(mask) == 0) continue;
+
+			vfloat qx = vfloat(SPVector.y) * directionZ - directionY * vfloat(SPVector.z);
+			vfloat qy = vfloat(SPVector.z) * directionX - directionZ * vfloat(SPVector.x);
+			vfloat qz = vfloat(SPVector.x) * directionY - directionX * vfloat(SPVector.y);
+			vfloat u = ((vfloat(geometry.e1x[j]) * qx + vfloat(geometry.e1y[j]) * qy) + vfloat(geometry.e1z[j]) * qz) * inverseDet;
+			vfloat v = -((vfloat(geometry.e0x[j]) * qx + vfloat(geometry.e0y[j]) * qy) + vfloat(geometry.e0z[j]) * qz) * inverseDet;
+			mask = mask & (u >= vfloat(0.0f)) & (u <= vfloat(1.0f)) & (v >= vfloat(0.0f)) & (v <= vfloat(1.0f)) & (u + v <= vfloat(1.0f));
+
+			int hits = vmovemask(mask);
+			if (hits == 0) continue;
+			closest = vselect(mask, t, closest);
+			closestU = vselect(mask, u, closestU);
+			closestV = vselect(mask, v, closestV);
+			for (int k = 0; k < SIMD_WIDTH; k++) if (hits & (1 << k)) hit.triangle[k] = j;
 		}
 	}
-	return currentClosest;
+	closest.store(hit.distance);
+	closestU.store(hit.u);
+	closestV.store(hit.v);
+}
+
+// how many rays of the packet starting at (blockX, blockY) are for pixels inside a width by height image
+int packetLanesInside(int blockX, int blockY, int width, int height) {
+	return std::min(PACKET_WIDTH, width - blockX) * std::min(PACKET_HEIGHT, height - blockY);
+}
+
+// the hit record of one ray in a packet
+HitRecord packetLane(const PacketHit& hit, int lane) {
+	HitRecord record;
+	record.distance = hit.distance[lane];
+	record.u = hit.u[lane];
+	record.v = hit.v[lane];
+	record.triangle = hit.triangle[lane];
+	return record;
+}
+
+// direction of the ray leaving the camera through pixel (x, y) of a width by height image
+vec3 primaryRayDirection(int x, int y, int width, int height, vec3 cameraPos, mat3 cameraOrientation, float focalLength, float scaleFactor) {
+	// Calculates x and y position in 3D space equivalent to the .obj file
+	// scale factor ^2 ensures scaling matches with rasterized and wireframe render
+	float u = ((x + cameraPos.x) - width / 2) / scaleFactor;
+	float v = -((y + cameraPos.y) - height / 2) / scaleFactor;
+
+	// Adjusts direction in accordance to camera orientation and position
+	vec3 rayDirection(u, v, -focalLength);
+	return normalize(rayDirection * cameraOrientation);
+}
+
+// works out the colour of a pixel from what its primary ray hit, shadow and mirror rays are traced one at a time from here
+uint32_t shadePixel(RayTriangleIntersection closestIntersection, const Scene& scene, vec3 cameraPos, vec3 light, int lightingMode) {
+	PROFILE_COUNT(COUNTER_PIXELS_SHADED, 1);
+	float brightness = 1;
+
+	// Colours hard shadows black
+	if (lightingMode == 1) brightness = hardShadowLighting(closestIntersection, scene, light);
+
+	// Colours pixels based on how far from light source (Proximity lighting)
+	if (lightingMode == 2) brightness = diffuseLighting(closestIntersection, light);
+
+	// utilization of all lighting effects
+	if (lightingMode == 3) brightness = allLighting(closestIntersection, cameraPos, scene, light);
+
+	// OPTIONAL :: add hard shadow
+	if (lightingMode == 4) brightness = gouraudShade(closestIntersection, cameraPos, light);
+
+	// OPTIONAL :: add hard shadow
+	if (scene.materials[closestIntersection.intersectedTriangle.material].shading == SHADING_PHONG && lightingMode >= 2) brightness = phongShade(closestIntersection, cameraPos, light);
+
+	closestIntersection = checkMirror(closestIntersection, scene, light);
+
+	return convertColour(calculateBrightness(closestIntersection, brightness, true));
 }
 
-// renders scene using ray-tracing
-void renderRayTracedScene(DrawingWindow& window, vector<ModelTriangle> triangles, vec3 cameraPos, mat3 cameraOrientation, vec3 light, int lightingMode, float focalLength, float scaleFactor) {
+// renders scene using ray-tracing, the screen is split into tiles which are shared out between threads
+// (tiles with mirrors and glass take longer, so threads that finish early steal the rest)
+// and each tile traces its primary rays a packet at a time
+void renderRayTracedScene(FrameBuffer& window, const Scene& scene, vec3 cameraPos, mat3 cameraOrientation, vec3 light, int lightingMode, float focalLength, float scaleFactor) {
+	PROFILE_FRAME("ray trace frame");
 	window.clearPixels();
-	for (int y = 0; y < HEIGHT; y++) {
-		for (int x = 0; x < WIDTH; x++) {
+#ifndef NDEBUG
+	size_t allocationsBefore = allocationCount;
+#endif
+	int width = window.width;
+	int height = window.height;
+	int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
 
-			// Calculates x and y position in 3D space equivalent to the .obj file
-			// scale factor ^2 ensures scaling matches with rasterized and wireframe render
-			float u = ((x + cameraPos.x) - WIDTH / 2) / scaleFactor;
-			float v = -((y + cameraPos.y) - HEIGHT / 2) / scaleFactor;
+	threadPool.parallelFor(tilesX * tilesY, [&](int tile) {
+		PROFILE_SCOPE("trace tile");
+		int startX = (tile % tilesX) * TILE_SIZE;
+		int startY = (tile / tilesX) * TILE_SIZE;
+		for (int blockY = startY; blockY < std::min(startY + TILE_SIZE, height); blockY += PACKET_HEIGHT) {
+			for (int blockX = startX; blockX < std::min(startX + TILE_SIZE, width); blockX += PACKET_WIDTH) {
+				vec3 rayDirections[SIMD_WIDTH];
+				for (int k = 0; k < SIMD_WIDTH; k++) {
+					rayDirections[k] = primaryRayDirection(blockX + k % PACKET_WIDTH, blockY + k / PACKET_WIDTH, width, height, cameraPos, cameraOrientation, focalLength, scaleFactor);
+				}
+				PacketHit hit;
+				{
+					PROFILE_TIME(COUNTER_INTERSECT_NANOSECONDS);
+					getClosestIntersections(cameraPos, rayDirections, scene, hit);
+				}
+				int inside = packetLanesInside(blockX, blockY, width, height);
+				countRays(inside);
+				PROFILE_COUNT(COUNTER_PRIMARY_RAYS, inside);
 
-			// Adjusts direction in accordance to camera orientation and position
-			vec3 rayDirection(u, v, -focalLength);
-			rayDirection = normalize(rayDirection * cameraOrientation);
+				for (int k = 0; k < SIMD_WIDTH; k++) {
+					int x = blockX + k % PACKET_WIDTH;
+					int y = blockY + k / PACKET_WIDTH;
+					// each pixel belongs to exactly one tile so threads never write to the same place
+					if (x < width && y < height) window.setPixelColour(x, y, shadePixel(resolveHit(packetLane(hit, k), scene), scene, cameraPos, light, lightingMode));
+				}
+			}
+		}
+	});
+#ifndef NDEBUG
+	// the scene is only ever read by reference, so tracing pixels should never touch the heap
+	if (allocationCount != allocationsBefore) std::cout << allocationCount - allocationsBefore << " heap allocations while ray tracing frame" << std::endl;
+#endif
+}
 
-			RayTriangleIntersection closestIntersection = getClosestIntersection(cameraPos, rayDirection, triangles);
-			
-			float brightness = 1;
+// the progressive ray tracer's first pass traces one pixel in every block this many pixels square, each pass after
+// halves it until every pixel has been traced (a power of 2 that divides TILE_SIZE, so blocks never cross tiles)
+#define PROGRESSIVE_BLOCK 8
+// roughly how long one call to renderRayTracedProgressive spends refining before it hands back to the window
+#define PROGRESSIVE_BUDGET_MS 30
 
-			// Colours hard shadows black
-			if (lightingMode == 1) brightness = hardShadowLighting(closestIntersection, triangles, light);
+static_assert(TILE_SIZE % PROGRESSIVE_BLOCK == 0, "progressive blocks must not cross tiles");
 
-			// Colours pixels based on how far from light source (Proximity lighting)
-			if (lightingMode == 2) brightness = diffuseLighting(closestIntersection, light);
+// How far the progressive ray tracer has got with a picture, and what it is a picture of
+struct ProgressiveTrace {
+	const Scene* scene = nullptr;
+	vec3 cameraPos;
+	mat3 cameraOrientation;
+	vec3 light;
+	int lightingMode = -1;
+	float focalLength = 0;
+	float scaleFactor = 0;
+	size_t width = 0;
+	size_t height = 0;
+	// block size of the pass in progress, 0 once every pixel has been traced
+	int blockSize = 0;
+	// first row of the next band of tiles the pass has to do
+	int nextRow = 0;
+
+	// starts again from the coarsest pass on the next call, for when something else has drawn over the window
+	void restart() {
+		scene = nullptr;
+	}
 
-			// utilization of all lighting effects
-			if (lightingMode == 3) brightness = allLighting(closestIntersection, cameraPos, triangles, light);
+	bool finished() const {
+		return scene != nullptr && blockSize == 0;
+	}
+};
 
-			// OPTIONAL :: add hard shadow
-			if (lightingMode == 4) brightness = gouraudShade(closestIntersection, cameraPos, light);
+// Ray traces scene a bit at a time over several calls, so the window stays responsive while the picture sharpens.
+// The first call traces one pixel per PROGRESSIVE_BLOCK square and fills each block with its colour. Every call after
+// that traces a band of tiles at a time until PROGRESSIVE_BUDGET_MS has passed, with each pass tracing the pixels
+// that sit halfway between the last pass's samples and filling the smaller blocks they start.
+// Every pixel ends up shaded exactly once, from the same packet as in renderRayTracedScene, so the finished picture is
+// exactly the same (packets are traced again for each pass that has pixels in them, but primary rays are the cheap part).
+// Anything that changes the picture (camera, light, lighting mode, window size or scene) starts it again.
+// Returns true once the picture is finished, calls after that do nothing.
+bool renderRayTracedProgressive(FrameBuffer& window, const Scene& scene, vec3 cameraPos, mat3 cameraOrientation, vec3 light, int lightingMode, float focalLength, float scaleFactor, ProgressiveTrace& progress) {
+	if (progress.scene != &scene || progress.cameraPos != cameraPos || progress.cameraOrientation != cameraOrientation || progress.light != light ||
+		progress.lightingMode != lightingMode || progress.focalLength != focalLength || progress.scaleFactor != scaleFactor ||
+		progress.width != window.width || progress.height != window.height) {
+		progress.scene = &scene;
+		progress.cameraPos = cameraPos;
+		progress.cameraOrientation = cameraOrientation;
+		progress.light = light;
+		progress.lightingMode = lightingMode;
+		progress.focalLength = focalLength;
+		progress.scaleFactor = scaleFactor;
+		progress.width = window.width;
+		progress.height = window.height;
+		progress.blockSize = PROGRESSIVE_BLOCK;
+		progress.nextRow = 0;
+	}
+	if (progress.blockSize == 0) return true;
 
-			// OPTIONAL :: add hard shadow
-			if (closestIntersection.intersectedTriangle.colour.name == "Red" && lightingMode >= 2) brightness = phongShade(closestIntersection, cameraPos, light);
+	PROFILE_FRAME("progressive ray trace");
+	auto start = chrono::steady_clock::now();
+	int width = window.width;
+	int height = window.height;
+	int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	uint32_t* pixels = window.getPixelBuffer();
+	while (progress.blockSize > 0) {
+		int block = progress.blockSize;
+		int startY = progress.nextRow;
+		threadPool.parallelFor(tilesX, [&](int tile) {
+			PROFILE_SCOPE("trace tile");
+			int startX = tile * TILE_SIZE;
+			for (int blockY = startY; blockY < std::min(startY + TILE_SIZE, height); blockY += PACKET_HEIGHT) {
+				for (int blockX = startX; blockX < std::min(startX + TILE_SIZE, width); blockX += PACKET_WIDTH) {
+					// the pixels of this packet the pass traces, pixels on the grid of the pass before were traced then
+					int samples = 0;
+					for (int k = 0; k < SIMD_WIDTH; k++) {
+						int x = blockX + k % PACKET_WIDTH;
+						int y = blockY + k / PACKET_WIDTH;
+						if (x >= width || y >= height || x % block != 0 || y % block != 0) continue;
+						if (block < PROGRESSIVE_BLOCK && x % (2 * block) == 0 && y % (2 * block) == 0) continue;
+						samples |= 1 << k;
+					}
+					if (samples == 0) continue;
 
-			closestIntersection = checkMirror(closestIntersection, triangles, light);
+					// the whole packet is traced just like renderRayTracedScene does, so every pixel gets the same hit it would there
+					vec3 rayDirections[SIMD_WIDTH];
+					for (int k = 0; k < SIMD_WIDTH; k++) {
+						rayDirections[k] = primaryRayDirection(blockX + k % PACKET_WIDTH, blockY + k / PACKET_WIDTH, width, height, cameraPos, cameraOrientation, focalLength, scaleFactor);
+					}
+					PacketHit hit;
+					getClosestIntersections(cameraPos, rayDirections, scene, hit);
+					int inside = packetLanesInside(blockX, blockY, width, height);
+					countRays(inside);
+					PROFILE_COUNT(COUNTER_PRIMARY_RAYS, inside);
 
-			window.setPixelColour(x, y, convertColour(calculateBrightness(closestIntersection, brightness, true)));
+					for (int k = 0; k < SIMD_WIDTH; k++) {
+						if (!(samples & (1 << k))) continue;
+						int x = blockX + k % PACKET_WIDTH;
+						int y = blockY + k / PACKET_WIDTH;
+						uint32_t colour = shadePixel(resolveHit(packetLane(hit, k), scene), scene, cameraPos, light, lightingMode);
+						for (int fillY = y; fillY < std::min(y + block, height); fillY++) {
+							std::fill_n(&pixels[fillY * width + x], std::min(block, width - x), colour);
+						}
+					}
+				}
+			}
+		});
 
+		progress.nextRow += TILE_SIZE;
+		if (progress.nextRow >= height) {
+			progress.blockSize /= 2;
+			progress.nextRow = 0;
 		}
+		// the coarse pass is always finished in one go, so the window never shows half of the old picture
+		if (block < PROGRESSIVE_BLOCK && chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() > PROGRESSIVE_BUDGET_MS) break;
 	}
-}
\ No newline at end of file
+	return progress.blockSize == 0;
+}
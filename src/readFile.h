@@ -1,3 +1,5 @@
+#include <unordered_map>
+
 using namespace std;
 using namespace glm;
 
@@ -11,209 +13,226 @@ uint32_t convertColour(Colour colour) {
 	return c;
 }
 
-// Given a colour name will return the equivalent Colour class, white (with name Unknown) if not found
-Colour getColour(string colour, vector<Colour> colourVec) {
-	for (int i = 0; i < colourVec.size(); i++) {
-		if (colourVec[i].name == colour) { return colourVec[i]; }
-	}
-	return Colour("Unknown", 0, 0, 0);
-}
+// triangles of mesh are worked through in blocks of this many when spread over the thread pool
+#define MESH_TRIANGLE_BLOCK 4096
 
-// Unloads a .obj file and stores the models in a vector
-vector<ModelTriangle> unloadobjFile(string fileName, float scalingFactor, vector<Colour> colourVec) {
-	ifstream file(fileName);
-	string line;
-	vector<ModelTriangle> v;
-	vector<glm::vec3> currentVectors;
-	Colour colour;
-	while (!file.eof()) {
-		getline(file, line);
-		vector<string> currentLine = split(line, ' ');
-		if (line[0] == 'u') {
-			colour = getColour(currentLine[1], colourVec);
-		}
-		else if (line[0] == 'v') {
-			glm::vec3 lineVector(stof(currentLine[1]) * scalingFactor, stof(currentLine[2]) * scalingFactor, stof(currentLine[3]) * scalingFactor);
-			currentVectors.push_back(lineVector);
-		}
-		else if (line[0] == 'f') {
-			glm::vec3 lineVector(stof(currentLine[1]), stof(currentLine[2]), stof(currentLine[3]));
-			ModelTriangle currentTriangle(currentVectors[lineVector[0] - 1], currentVectors[lineVector[1] - 1], currentVectors[lineVector[2] - 1], colour);
-			// calculates normal of triangle from 2 edges
-			currentTriangle.normal = glm::cross(currentTriangle.vertices[1] - currentTriangle.vertices[0], currentTriangle.vertices[2] - currentTriangle.vertices[0]);
-			v.push_back(currentTriangle);
+// angle in degrees between two faces above which they do not smooth into each other, 180 smooths everything sharing a vertex
+#define VERTEX_NORMAL_CREASE_ANGLE 180.0f
+
+// bit pattern of a position so identical positions can be found by hashing, -0 is made +0 first since they compare equal
+struct PositionKey {
+	uint32_t bits[3];
+
+	PositionKey(vec3 position) {
+		for (int k = 0; k < 3; k++) {
+			float value = position[k] + 0.0f;
+			memcpy(&bits[k], &value, sizeof(float));
 		}
 	}
-	return v;
-}
 
-// Unloads a .obj file and stores the models in a vector
-vector<ModelTriangle> unloadTextureFile(string fileName, float scalingFactor, vector<Colour> colourVec) {
-	ifstream file(fileName);
-	string line;
-	vector<ModelTriangle> v;
-	vector<glm::vec3> currentVectors;
-	vector<TexturePoint> textureVectors;
-	Colour colour;
-	while (!file.eof()) {
-		getline(file, line);
-		vector<string> currentLine = split(line, ' ');
-		if (line[0] == 'u') {
-			colour = getColour(currentLine[1], colourVec);
-		}
-		else if (line[0] == 'v' && (line[1] != 't' && line[1] != 'n')) {
-			glm::vec3 lineVector(stof(currentLine[1]) * scalingFactor, stof(currentLine[2]) * scalingFactor, stof(currentLine[3]) * scalingFactor);
-			currentVectors.push_back(lineVector);
-		}
-		else if (line[0] == 'v' && line[1] == 't') {
-			TexturePoint point(stof(currentLine[1]), stof(currentLine[2]));
-			textureVectors.push_back(point);
-		}
-		else if (line[0] == 'f') {
-			string currentLineString = line;
-			replace(currentLineString.begin(), currentLineString.end(), '/', ' ');
-			vector<string> lineVector = split(currentLineString, ' '); 
+	bool operator==(const PositionKey& other) const {
+		return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+	}
+};
+
+struct PositionKeyHash {
+	size_t operator()(const PositionKey& key) const {
+		uint64_t hash = (uint64_t)key.bits[0] * 0x9E3779B97F4A7C15ull;
+		hash = (hash ^ key.bits[1]) * 0xC2B2AE3D27D4EB4Full;
+		hash = (hash ^ key.bits[2]) * 0x165667B19E3779F9ull;
+		return hash ^ (hash >> 32);
+	}
+};
 
-			lineVector.erase(lineVector.begin()); // remove f at beginning
-			lineVector.erase(remove(lineVector.begin(), lineVector.end(), ""), lineVector.end()); // remove all empty spaces
+// (unnormalized) face normal of triangle t of a parsed .obj file, worked out from 2 edges
+vec3 objFaceNormal(const ObjMesh& obj, int t) {
+	const ObjCorner* corners = &obj.corners[3 * t];
+	vec3 v0 = obj.positions[corners[0].position];
+	return glm::cross(obj.positions[corners[1].position] - v0, obj.positions[corners[2].position] - v0);
+}
 
+// Gives every corner of obj the normalized sum of the (area weighted) face normals of all triangles sharing its position.
+// Positions are welded with a hash map, so this is linear in the number of triangles.
+// With a creaseAngle below 180 a corner only takes faces within that many degrees of its own face, keeping hard edges sharp.
+vector<vec3> getVertexNormals(const ObjMesh& obj, float creaseAngle = VERTEX_NORMAL_CREASE_ANGLE) {
+	int triangleCount = obj.triangleCount();
+	int cornerCount = obj.corners.size();
+	int blocks = (triangleCount + MESH_TRIANGLE_BLOCK - 1) / MESH_TRIANGLE_BLOCK;
+	vector<vec3> faceNormals(triangleCount);
+	threadPool.parallelFor(blocks, [&](int block) {
+		int end = std::min(triangleCount, (block + 1) * MESH_TRIANGLE_BLOCK);
+		for (int i = block * MESH_TRIANGLE_BLOCK; i < end; i++) faceNormals[i] = objFaceNormal(obj, i);
+	});
+
+	vector<int> positionIds(cornerCount);
+	unordered_map<PositionKey, int, PositionKeyHash> ids;
+	ids.reserve(obj.positions.size());
+	for (int c = 0; c < cornerCount; c++) {
+		positionIds[c] = ids.emplace(PositionKey(obj.positions[obj.corners[c].position]), ids.size()).first->second;
+	}
 
-			if (lineVector.size() == 3) {
-				ModelTriangle currentTriangle(currentVectors[stof(lineVector[0])-1], currentVectors[stof(lineVector[1])-1], currentVectors[stof(lineVector[2])-1], colour);
-				// calculates normal of triangle from 2 edges
-				currentTriangle.normal = glm::cross(currentTriangle.vertices[1] - currentTriangle.vertices[0], currentTriangle.vertices[2] - currentTriangle.vertices[0]);
-				v.push_back(currentTriangle);
-			}
-			else if (lineVector.size() == 6) {
-				ModelTriangle currentTriangle(currentVectors[stof(lineVector[0])-1], currentVectors[stof(lineVector[2])-1], currentVectors[stof(lineVector[4])-1], colour);
-				// calculates normal of triangle from 2 edges
-				currentTriangle.normal = glm::cross(currentTriangle.vertices[1] - currentTriangle.vertices[0], currentTriangle.vertices[2] - currentTriangle.vertices[0]);
-				currentTriangle.colour = Colour(255, 255, 255);
-				currentTriangle.colour.texture = true;
-				currentTriangle.texturePoints = { textureVectors[stof(lineVector[1])-1], textureVectors[stof(lineVector[3])-1], textureVectors[stof(lineVector[5])-1]};
-				v.push_back(currentTriangle);
-			}
-		}
+	// each triangle counts once per position even if it touches it more than once
+	auto touchesEarlier = [&](int c) {
+		int first = c - c % 3;
+		for (int k = first; k < c; k++) if (positionIds[k] == positionIds[c]) return true;
+		return false;
+	};
+
+	vector<vec3> normals(cornerCount);
+	if (creaseAngle >= 180.0f) {
+		vector<vec3> sums(ids.size(), vec3(0, 0, 0));
+		for (int c = 0; c < cornerCount; c++) {
+			if (!touchesEarlier(c)) sums[positionIds[c]] = sums[positionIds[c]] + faceNormals[c / 3];
+		}
+		threadPool.parallelFor(blocks, [&](int block) {
+			int end = std::min(cornerCount, 3 * (block + 1) * MESH_TRIANGLE_BLOCK);
+			for (int c = 3 * block * MESH_TRIANGLE_BLOCK; c < end; c++) normals[c] = normalize(sums[positionIds[c]]);
+		});
+		return normals;
 	}
-	return v;
-}
 
-vector<ModelTriangle> getVertexNormals(vector<ModelTriangle> triangles) {
-	for (int i = 0; i < triangles.size(); i++) {
-		vec3 v0 = triangles[i].vertices[0];
-		vec3 sum(0, 0, 0);
-		// get 1st vertex normal
-		for (int j = 0; j < triangles.size(); j++) {
-			if (v0 == triangles[j].vertices[0] || v0 == triangles[j].vertices[1] || v0 == triangles[j].vertices[2]) {
-				sum = sum + triangles[j].normal;
-			}
-		}
-		triangles[i].vertex_normals[0] = normalize(sum);
-		// get 2nd vertex normal
-		vec3 v1 = triangles[i].vertices[1];
-		sum = vec3(0, 0, 0);
-		for (int j = 0; j < triangles.size(); j++) {
-			if (v1 == triangles[j].vertices[0] || v1 == triangles[j].vertices[1] || v1 == triangles[j].vertices[2]) {
-				sum = sum + triangles[j].normal;
+	// faces around every position (compressed rows, faces of position p are faces[first[p]] to faces[first[p + 1] - 1])
+	vector<int> first(ids.size() + 1, 0);
+	for (int c = 0; c < cornerCount; c++) if (!touchesEarlier(c)) first[positionIds[c] + 1]++;
+	for (size_t p = 0; p < ids.size(); p++) first[p + 1] += first[p];
+	vector<int> faces(first.back());
+	vector<int> filled(first.begin(), first.end() - 1);
+	for (int c = 0; c < cornerCount; c++) if (!touchesEarlier(c)) faces[filled[positionIds[c]]++] = c / 3;
+
+	vector<vec3> faceDirections(triangleCount);
+	for (int i = 0; i < triangleCount; i++) {
+		float length = glm::length(faceNormals[i]);
+		faceDirections[i] = length > 0 ? faceNormals[i] / length : vec3(0, 0, 0);
+	}
+	float minimumCosine = cos(glm::radians(creaseAngle));
+	threadPool.parallelFor(blocks, [&](int block) {
+		int end = std::min(triangleCount, (block + 1) * MESH_TRIANGLE_BLOCK);
+		for (int i = block * MESH_TRIANGLE_BLOCK; i < end; i++) {
+			for (int k = 0; k < 3; k++) {
+				int position = positionIds[3 * i + k];
+				vec3 sum(0, 0, 0);
+				for (int f = first[position]; f < first[position + 1]; f++) {
+					int face = faces[f];
+					if (face == i || dot(faceDirections[face], faceDirections[i]) >= minimumCosine) sum = sum + faceNormals[face];
+				}
+				normals[3 * i + k] = normalize(sum);
 			}
 		}
-		triangles[i].vertex_normals[1] = normalize(sum);
-		// get 3rd vertex normal
-		vec3 v2 = triangles[i].vertices[2];
-		sum = vec3(0, 0, 0);
-		for (int j = 0; j < triangles.size(); j++) {
-			if (v2 == triangles[j].vertices[0] || v2 == triangles[j].vertices[1] || v2 == triangles[j].vertices[2]) {
-				sum = sum + triangles[j].normal;
+	});
+	return normals;
+}
+
+// what makes two corners the same vertex of a Mesh: the .obj position they use, their texture point (-1 if none)
+// and the bits of their normal
+struct VertexKey {
+	int position;
+	int texture;
+	uint32_t normal[3];
+
+	VertexKey(int position, int texture, vec3 normal) : position(position), texture(texture) {
+		memcpy(this->normal, &normal[0], sizeof(this->normal));
+	}
+
+	bool operator==(const VertexKey& other) const {
+		return position == other.position && texture == other.texture
+			&& normal[0] == other.normal[0] && normal[1] == other.normal[1] && normal[2] == other.normal[2];
+	}
+};
+
+struct VertexKeyHash {
+	size_t operator()(const VertexKey& key) const {
+		uint64_t hash = ((uint64_t)(uint32_t)key.position << 32 | (uint32_t)key.texture) * 0x9E3779B97F4A7C15ull;
+		hash = (hash ^ key.normal[0]) * 0xC2B2AE3D27D4EB4Full;
+		hash = (hash ^ ((uint64_t)key.normal[1] << 32 | key.normal[2])) * 0x165667B19E3779F9ull;
+		return hash ^ (hash >> 32);
+	}
+};
+
+// Turns a parsed .obj file into a Mesh, corners with the same position, texture point and normal become one vertex.
+// useTextures keeps the texture points of faces that give all three, smoothNormals works out vertex normals
+// with getVertexNormals (leaving them zero otherwise).
+Mesh buildMesh(const ObjMesh& obj, bool useTextures, bool smoothNormals) {
+	Mesh mesh;
+	int triangleCount = obj.triangleCount();
+	vector<vec3> cornerNormals;
+	if (smoothNormals) cornerNormals = getVertexNormals(obj);
+
+	mesh.materials = obj.materials;
+	mesh.textured.resize(triangleCount);
+	mesh.indices.resize(3 * triangleCount);
+	unordered_map<VertexKey, uint32_t, VertexKeyHash> vertices;
+	vertices.reserve(obj.positions.size());
+	for (int t = 0; t < triangleCount; t++) {
+		const ObjCorner* corners = &obj.corners[3 * t];
+		bool textured = useTextures && corners[0].texture != -1 && corners[1].texture != -1 && corners[2].texture != -1;
+		mesh.textured[t] = textured;
+		for (int k = 0; k < 3; k++) {
+			const ObjCorner& corner = corners[k];
+			vec3 normal = smoothNormals ? cornerNormals[3 * t + k] : vec3(0, 0, 0);
+			auto inserted = vertices.emplace(VertexKey(corner.position, textured ? corner.texture : -1, normal), mesh.positions.size());
+			if (inserted.second) {
+				mesh.positions.push_back(obj.positions[corner.position]);
+				mesh.normals.push_back(normal);
+				mesh.texturePoints.push_back(textured ? obj.texturePoints[corner.texture] : TexturePoint());
 			}
+			mesh.indices[3 * t + k] = inserted.first->second;
 		}
-		triangles[i].vertex_normals[2] = normalize(sum);
 	}
-	return triangles;
+	return mesh;
 }
 
+// Unloads a .obj file into a mesh of flat coloured triangles
+Mesh unloadobjFile(string fileName, float scalingFactor, const MaterialTable& materials) {
+	return buildMesh(parseObjFile(fileName, scalingFactor, materials), false, false);
+}
 
-vector<ModelTriangle> unloadNewFile(string fileName, float scalingFactor, vector<Colour> colourVec) {
-	ifstream file(fileName);
-	string line;
-	vector<ModelTriangle> v;
-	vector<glm::vec3> currentVectors;
-	vector<glm::vec3> currentNormals;
-	Colour colour;
-	while (!file.eof()) {
-		getline(file, line);
-		vector<string> currentLine = split(line, ' ');
-		if (line[0] == 'v' && (line[1] != 't' && line[1] != 'n')) {
-			glm::vec3 lineVector(stof(currentLine[1]) * scalingFactor, stof(currentLine[2]) * scalingFactor, stof(currentLine[3]) * scalingFactor);
-			currentVectors.push_back(lineVector);
-		} 	if (line[0] == 'u') {
-			colour = getColour(currentLine[1], colourVec);
-		}
-		else if (line[0] == 'v' && line[1] == 'n') {
-			glm::vec3 lineVector(stof(currentLine[1]) * scalingFactor, stof(currentLine[2]) * scalingFactor, stof(currentLine[3]) * scalingFactor);
-			currentNormals.push_back(lineVector);
-		}
-		else if (line[0] == 'f') {
-			glm::vec3 lineVector(stof(currentLine[1]), stof(currentLine[2]), stof(currentLine[3]));
-			
-			ModelTriangle currentTriangle(currentVectors[lineVector[0] - 1], currentVectors[lineVector[1] - 1], currentVectors[lineVector[2] - 1], colour);
-			// calculates normal of triangle from 2 edges
-			currentTriangle.normal = glm::cross(currentTriangle.vertices[1] - currentTriangle.vertices[0], currentTriangle.vertices[2] - currentTriangle.vertices[0]);
-			currentTriangle.colour = colour;
-			if (colour.name == "Grey") {
-				currentTriangle.material = 2;
-			}
-			if (colour.name == "Orange") {
-				currentTriangle.material = 3;
-			}
+// Unloads a .obj file into a mesh, faces with texture coordinates are drawn with the texture
+Mesh unloadTextureFile(string fileName, float scalingFactor, const MaterialTable& materials) {
+	return buildMesh(parseObjFile(fileName, scalingFactor, materials), true, false);
+}
 
-			if (currentNormals.size() > 0) currentTriangle.vertex_normals = {currentNormals[lineVector[0] - 1], currentNormals[lineVector[1] - 1], currentNormals[lineVector[2] - 1]};
-			v.push_back(currentTriangle);
-		}
-	}
-	return getVertexNormals(v);
+// Unloads a .obj file into a mesh with smoothed vertex normals, worked out from the faces (vn lines in the file are not used)
+Mesh unloadNewFile(string fileName, float scalingFactor, const MaterialTable& materials) {
+	return buildMesh(parseObjFile(fileName, scalingFactor, materials), false, true);
 }
 
-// Unloads a .mtl file and stores the relevant colours in a vector
-vector<Colour> unloadMaterialFile(string fileName) {
+// Unloads a .mtl file into a table of materials, triangles then refer to them by id
+// reads Kd (colour), Ni (index of refraction), illum (see applyIllumination), Pm (reflectivity) and map_Kd (texture,
+// whose only option used is -clamp: on clamps lookups outside the texture to its edges, off repeats it)
+// namedSurfaces gives the old scenes' Grey and Orange materials their metal and glass (see defaultMaterial)
+MaterialTable unloadMaterialFile(string fileName, bool namedSurfaces = false) {
 	ifstream file(fileName);
 	string line;
-	vector<Colour> c;
-	string name;
-	while (!file.eof()) {
-		getline(file, line);
-		if (line[0] == 'n') {
-			vector<string> currentLine = split(line, ' ');
-			name = currentLine[1];
-		}
-		else if (line[0] == 'K') {
-			vector<string> currentLine = split(line, ' ');
-			c.push_back(Colour(name, round(stof(currentLine[1]) * 255), round(stof(currentLine[2]) * 255), round(stof(currentLine[3]) * 255)));
-		}
-		else if (line[0] == 'm') {
-			if (c.size() == 0) {
-				Colour newColour(255, 255, 255);
-				newColour.texture = true;
-				c.push_back(newColour);
+	MaterialTable materials;
+	// a missing file reads as no materials
+	while (getline(file, line)) {
+		vector<string> currentLine = split(line, ' ');
+		if (currentLine.size() < 2) continue;
+		string key = currentLine[0];
+		if (key == "newmtl") {
+			materials.materials.push_back(defaultMaterial(currentLine[1], namedSurfaces));
+			continue;
+		}
+		// a texture with no material before it gets a white one of its own
+		if (materials.materials.size() == 1) materials.materials.push_back(defaultMaterial("", namedSurfaces));
+		Material& material = materials.materials.back();
+
+		if (key == "Kd" && currentLine.size() >= 4) {
+			material.albedo = Colour(round(stof(currentLine[1]) * 255), round(stof(currentLine[2]) * 255), round(stof(currentLine[3]) * 255));
+		}
+		else if (key == "Ni") material.ior = stof(currentLine[1]);
+		else if (key == "Pm") material.reflectivity = stof(currentLine[1]);
+		else if (key == "illum") applyIllumination(material, stoi(currentLine[1]));
+		else if (key == "map_Kd") {
+			if (material.name.empty()) material.albedo = Colour(255, 255, 255);
+			// options come before the file name, which is last
+			for (size_t i = 1; i + 2 < currentLine.size(); i++) {
+				if (currentLine[i] == "-clamp") material.textureWrap = currentLine[i + 1] == "off" ? TEXTURE_REPEAT : TEXTURE_CLAMP;
 			}
-			else c.back().texture = true;
-
-		}
-	}
-	return c;
-}
-
-// Given texture map, puts into format where each row corresponds to y value pixels
-std::vector<std::vector<uint32_t>> unloadTexture(TextureMap texture) {
-	std::vector<std::vector<uint32_t>> sortedTexture;
-	std::vector<uint32_t> currentRow;
-	for (int i = 0; i < texture.height; i++) {
-		for (int j = 0; j < texture.width; j++) {
-			currentRow.push_back(texture.pixels[j + (texture.width * i)]);
+			material.texture = materials.addTexture(currentLine.back());
 		}
-		sortedTexture.push_back(currentRow);
-		currentRow.clear();
 	}
-	return sortedTexture;
+	return materials;
 }
 
 std::vector<uint32_t> getColourMap(std::vector<float> t0, std::vector<float> t1, int steps, std::vector<std::vector<uint32_t>> sortedTexture) {
@@ -229,7 +248,7 @@ std::vector<uint32_t> getColourMap(std::vector<float> t0, std::vector<float> t1,
 }
 
 // scales texture point based on height and width of texture
-TexturePoint scaleTexturePoint(TextureMap texture, TexturePoint point) {
+TexturePoint scaleTexturePoint(const TextureView& texture, TexturePoint point) {
 	int height = texture.height;
 	int width = texture.width;
 	return TexturePoint(point.x * width, point.y * height);
@@ -0,0 +1,37 @@
+// Everything the renderers need, in the order the headers depend on each other.
+// Each program (the SDL window in main.cpp, the headless one in headless.cpp) includes this once.
+#include <CanvasTriangle.h>
+#include <FrameBuffer.h>
+#include <Utils.h>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <glm/glm.hpp>
+
+#include <CanvasPoint.h>
+#include <Colour.h>
+#include <TextureMap.h>
+#include <ModelTriangle.h>
+#include <RayTriangleIntersection.h>
+
+#include <allocationCounter.h>
+#include <threadPool.h>
+#include <rayCounter.h>
+#include <profiler.h>
+#include <simd.h>
+#include <material.h>
+#include <textureCache.h>
+#include <objParser.h>
+#include <mesh.h>
+#include <bvh.h>
+#include <scene.h>
+#include <camera.h>
+#include <interpolate.h>
+#include <lighting.h>
+#include <triangleRaster.h>
+#include <rasterize.h>
+#include <raytrace.h>
+#include <readFile.h>
+#include <sceneCache.h>
+#include <wireframe.h>
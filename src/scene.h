@@ -0,0 +1,80 @@
+using namespace std;
+using namespace glm;
+
+// Triangle positions stored the way the intersection tests want them, one array per component (structure of arrays),
+// so walking a leaf only streams the floats it needs instead of whole ModelTriangles with their names and texture points.
+// Edges and the (unnormalized) normal are worked out at load time. Entry j is the triangle at bvh.triangleIndices[j].
+struct TriangleGeometry {
+	vector<float> v0x, v0y, v0z;
+	vector<float> e0x, e0y, e0z;
+	vector<float> e1x, e1y, e1z;
+	vector<float> normalX, normalY, normalZ;
+	// surface type of the triangle's material (SURFACE_DIFFUSE etc), so filtering by it does not have to touch the triangle
+	vector<int> surface;
+
+	vec3 v0(int j) const { return vec3(v0x[j], v0y[j], v0z[j]); }
+	vec3 e0(int j) const { return vec3(e0x[j], e0y[j], e0z[j]); }
+	vec3 e1(int j) const { return vec3(e1x[j], e1y[j], e1z[j]); }
+	vec3 normal(int j) const { return vec3(normalX[j], normalY[j], normalZ[j]); }
+
+	// point on triangle j at barycentrics (u, v)
+	vec3 pointAt(int j, float u, float v) const { return v0(j) + (u * e0(j)) + (v * e1(j)); }
+
+	// appends triangle t of mesh
+	void add(const Mesh& mesh, int t, const Material& material) {
+		vec3 v0 = mesh.position(t, 0);
+		vec3 e0 = mesh.position(t, 1) - v0;
+		vec3 e1 = mesh.position(t, 2) - v0;
+		vec3 normal = cross(e0, e1);
+		v0x.push_back(v0.x); v0y.push_back(v0.y); v0z.push_back(v0.z);
+		e0x.push_back(e0.x); e0y.push_back(e0.y); e0z.push_back(e0.z);
+		e1x.push_back(e1.x); e1y.push_back(e1.y); e1z.push_back(e1.z);
+		normalX.push_back(normal.x); normalY.push_back(normal.y); normalZ.push_back(normal.z);
+		surface.push_back(material.surface);
+	}
+};
+
+// everything the renderers need to know about the loaded model, built once and then only read while rendering
+struct Scene {
+	Mesh mesh;
+	MaterialTable materials;
+	// handles match materials.texturePaths, so a material's texture field is its handle here
+	TextureCache textures;
+	BVH bvh;
+	// same order as bvh.triangleIndices so each leaf reads a contiguous run,
+	// the full ModelTriangle is only looked up for the hit that ends up being shaded
+	TriangleGeometry geometry;
+};
+
+// closest hit of a ray, small enough to update freely while walking the BVH
+// triangle is the position in bvh.triangleIndices (so it indexes scene.geometry directly), or -1 if nothing was hit
+struct HitRecord {
+	float distance = numeric_limits<float>::max();
+	float u = 0;
+	float v = 0;
+	int triangle = -1;
+};
+
+// colour of the triangle a ray hit, black if it missed, without copying the rest of the triangle
+Colour hitColour(const HitRecord& hit, const Scene& scene) {
+	if (hit.triangle == -1) return Colour(0, 0, 0);
+	Colour colour = scene.mesh.colour(scene.bvh.triangleIndices[hit.triangle], scene.materials);
+	return Colour(colour.red, colour.green, colour.blue);
+}
+
+// puts a scene together from its parts, loading its textures and laying out the geometry in the order of bvh
+Scene assembleScene(Mesh mesh, MaterialTable materials, BVH bvh) {
+	Scene scene;
+	scene.materials = std::move(materials);
+	for (const string& path : scene.materials.texturePaths) scene.textures.load(path);
+	scene.bvh = std::move(bvh);
+	for (int index : scene.bvh.triangleIndices) scene.geometry.add(mesh, index, scene.materials[mesh.materials[index]]);
+	scene.mesh = std::move(mesh);
+	return scene;
+}
+
+// takes ownership of the loaded mesh and builds the acceleration structure over it
+Scene buildScene(Mesh mesh, MaterialTable materials) {
+	BVH bvh = buildBVH(mesh);
+	return assembleScene(std::move(mesh), std::move(materials), std::move(bvh));
+}
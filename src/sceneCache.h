@@ -0,0 +1,253 @@
+#include <chrono>
+#include <cstdio>
+#include <type_traits>
+
+using namespace std;
+using namespace glm;
+
+// Binary copy of a loaded scene (mesh, material table and the built BVH) written next to the .obj file after it is
+// first parsed, so later runs only have to map it and copy the arrays out. The header holds a hash of the source files,
+// the scaling factor and the loader, so editing any of them makes the old cache be ignored and rewritten.
+// Everything is stored in the machine's own layout and byte order, the cache is not meant to be moved between machines.
+// Bump SCENE_CACHE_VERSION whenever the layout or the way scenes are built (like the BVH) changes.
+#define SCENE_CACHE_VERSION 4
+#define SCENE_CACHE_MAGIC 0x53434743 // "CGCS"
+
+struct SceneCacheHeader {
+	uint32_t magic = SCENE_CACHE_MAGIC;
+	uint32_t version = SCENE_CACHE_VERSION;
+	uint64_t sourceHash = 0;
+	uint32_t vertexSize = sizeof(vec3) + sizeof(TexturePoint);
+	uint32_t nodeSize = sizeof(BVHNode);
+};
+
+// 64 bit FNV-1a style hash, taking 8 bytes at a time so hashing a large .obj file costs far less than parsing it
+uint64_t hashBytes(const char* bytes, size_t length, uint64_t hash = 14695981039346656037ull) {
+	const uint64_t prime = 1099511628211ull;
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+	for (; i < length; i++) hash = (hash ^ (unsigned char)bytes[i]) * prime;
+	return hash;
+}
+
+// appends plain values and arrays of them to a byte buffer
+struct CacheWriter {
+	vector<char> bytes;
+
+	template <typename T>
+	void put(const T& value) {
+		static_assert(is_trivially_copyable<T>::value, "only plain data can be cached");
+		const char* p = reinterpret_cast<const char*>(&value);
+		bytes.insert(bytes.end(), p, p + sizeof(T));
+	}
+
+	template <typename T>
+	void putArray(const vector<T>& values) {
+		static_assert(is_trivially_copyable<T>::value, "only plain data can be cached");
+		put<uint64_t>(values.size());
+		const char* p = reinterpret_cast<const char*>(values.data());
+		bytes.insert(bytes.end(), p, p + values.size() * sizeof(T));
+	}
+
+	void putString(const string& value) {
+		put<uint64_t>(value.size());
+		bytes.insert(bytes.end(), value.begin(), value.end());
+	}
+};
+
+// reads back what CacheWriter wrote, ok turns false (and stays false) if the data runs out early
+struct CacheReader {
+	const char* p;
+	const char* end;
+	bool ok = true;
+
+	bool take(void* destination, size_t length) {
+		if (!ok || (size_t)(end - p) < length) return ok = false;
+		if (length > 0) memcpy(destination, p, length); // empty arrays have no data pointer to copy to
+		p += length;
+		return true;
+	}
+
+	template <typename T>
+	T get() {
+		T value{};
+		take(&value, sizeof(T));
+		return value;
+	}
+
+	template <typename T>
+	void getArray(vector<T>& values) {
+		uint64_t count;
+		if (!getCount(count, sizeof(T))) return;
+		values.resize(count);
+		take(values.data(), count * sizeof(T));
+	}
+
+	// number of entries that follow, false if the rest of the data could not hold that many of at least minimumSize bytes
+	bool getCount(uint64_t& count, size_t minimumSize) {
+		count = get<uint64_t>();
+		if (ok && count > (uint64_t)(end - p) / minimumSize) ok = false;
+		return ok;
+	}
+
+	string getString() {
+		uint64_t length = get<uint64_t>();
+		if (!ok || length > (uint64_t)(end - p)) {
+			ok = false;
+			return string();
+		}
+		string value(p, length);
+		p += length;
+		return value;
+	}
+};
+
+// hash of everything the loaded scene depends on, 0 if a source file cannot be read
+uint64_t sceneSourceHash(const string& objFile, const string& mtlFile, float scalingFactor, int loaderId) {
+	uint64_t hash = hashBytes(reinterpret_cast<const char*>(&scalingFactor), sizeof(float));
+	hash = hashBytes(reinterpret_cast<const char*>(&loaderId), sizeof(int), hash);
+	for (const string& fileName : { objFile, mtlFile }) {
+		MappedFile file(fileName);
+		if (file.size() == 0) return 0;
+		hash = hashBytes(file.begin(), file.size(), hash);
+	}
+	return hash;
+}
+
+void writeSceneCache(const string& cacheFile, uint64_t sourceHash, const Scene& scene) {
+	CacheWriter writer;
+	SceneCacheHeader header;
+	header.sourceHash = sourceHash;
+	writer.put(header);
+
+	const MaterialTable& materials = scene.materials;
+	writer.put<uint64_t>(materials.materials.size());
+	for (const Material& material : materials.materials) {
+		writer.putString(material.name);
+		writer.put(material.albedo.red);
+		writer.put(material.albedo.green);
+		writer.put(material.albedo.blue);
+		writer.put(material.surface);
+		writer.put(material.reflectivity);
+		writer.put(material.ior);
+		writer.put(material.shading);
+		writer.put(material.texture);
+		writer.put(material.textureWrap);
+	}
+	writer.put<uint64_t>(materials.texturePaths.size());
+	for (const string& path : materials.texturePaths) writer.putString(path);
+
+	const Mesh& mesh = scene.mesh;
+	writer.putArray(mesh.positions);
+	writer.putArray(mesh.normals);
+	writer.putArray(mesh.texturePoints);
+	writer.putArray(mesh.indices);
+	writer.putArray(mesh.materials);
+	writer.putArray(mesh.textured);
+	writer.putArray(scene.bvh.nodes);
+	writer.putArray(scene.bvh.triangleIndices);
+
+	// written under a temporary name and renamed, so a job starting at the same time never maps half a file
+	string temporaryFile = cacheFile + "." + to_string(chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+	ofstream file(temporaryFile, ios::binary);
+	file.write(writer.bytes.data(), writer.bytes.size());
+	file.close();
+	if (!file || std::rename(temporaryFile.c_str(), cacheFile.c_str()) != 0) std::remove(temporaryFile.c_str());
+}
+
+// whether a BVH read back from a cache can be walked without leaving its arrays: every leaf's run lies inside
+// triangleIndices, which holds each triangle, and every interior node's children come after it (so there are no loops)
+// no deeper than the traversal stacks allow
+bool validCachedBVH(const BVH& bvh, size_t triangleCount) {
+	if (bvh.nodes.empty() != (triangleCount == 0) || bvh.triangleIndices.size() != triangleCount) return false;
+	for (int index : bvh.triangleIndices) if (index < 0 || index >= (int64_t)triangleCount) return false;
+	vector<int> depths(bvh.nodes.size(), 0);
+	for (size_t i = 0; i < bvh.nodes.size(); i++) {
+		const BVHNode& node = bvh.nodes[i];
+		if (node.leftFirst < 0 || node.count < 0) return false;
+		if (node.count > 0) {
+			if ((int64_t)node.leftFirst + node.count > (int64_t)triangleCount) return false;
+			continue;
+		}
+		if (node.leftFirst <= (int64_t)i || (int64_t)node.leftFirst + 1 >= (int64_t)bvh.nodes.size() || depths[i] >= BVH_MAX_DEPTH) return false;
+		// a child listed under two parents keeps the deeper one, as the parents come first that is the last one seen
+		depths[node.leftFirst] = std::max(depths[node.leftFirst], depths[i] + 1);
+		depths[node.leftFirst + 1] = std::max(depths[node.leftFirst + 1], depths[i] + 1);
+	}
+	return true;
+}
+
+// fills scene from cacheFile, false if there is no cache, it was made from different sources or it does not hold together
+bool readSceneCache(const string& cacheFile, uint64_t sourceHash, Scene& scene) {
+	MappedFile file(cacheFile);
+	CacheReader reader{ file.begin(), file.end() };
+	SceneCacheHeader expected;
+	SceneCacheHeader header = reader.get<SceneCacheHeader>();
+	if (!reader.ok || header.magic != expected.magic || header.version != expected.version || header.sourceHash != sourceHash
+		|| header.vertexSize != expected.vertexSize || header.nodeSize != expected.nodeSize) return false;
+
+	MaterialTable materials;
+	uint64_t count;
+	if (!reader.getCount(count, sizeof(uint64_t))) return false;
+	materials.materials.resize(count);
+	for (Material& material : materials.materials) {
+		material.name = reader.getString();
+		int red = reader.get<int>();
+		int green = reader.get<int>();
+		int blue = reader.get<int>();
+		material.albedo = Colour(red, green, blue);
+		material.surface = reader.get<int>();
+		material.reflectivity = reader.get<float>();
+		material.ior = reader.get<float>();
+		material.shading = reader.get<int>();
+		material.texture = reader.get<int>();
+		material.textureWrap = reader.get<int>();
+		if (!reader.ok) return false;
+	}
+	if (!reader.getCount(count, sizeof(uint64_t))) return false;
+	materials.texturePaths.resize(count);
+	for (string& path : materials.texturePaths) path = reader.getString();
+
+	Mesh mesh;
+	BVH bvh;
+	reader.getArray(mesh.positions);
+	reader.getArray(mesh.normals);
+	reader.getArray(mesh.texturePoints);
+	reader.getArray(mesh.indices);
+	reader.getArray(mesh.materials);
+	reader.getArray(mesh.textured);
+	reader.getArray(bvh.nodes);
+	reader.getArray(bvh.triangleIndices);
+	size_t triangleCount = mesh.materials.size();
+	size_t vertexCount = mesh.positions.size();
+	if (!reader.ok || materials.materials.empty() || mesh.normals.size() != vertexCount || mesh.texturePoints.size() != vertexCount
+		|| mesh.indices.size() != 3 * triangleCount || mesh.textured.size() != triangleCount || !validCachedBVH(bvh, triangleCount)) return false;
+	for (uint32_t index : mesh.indices) if (index >= vertexCount) return false;
+	for (int material : mesh.materials) if (material < 0 || material >= (int)materials.materials.size()) return false;
+	for (const Material& material : materials.materials) {
+		if (material.texture < -1 || material.texture >= (int)materials.texturePaths.size()) return false;
+	}
+	scene = assembleScene(std::move(mesh), std::move(materials), std::move(bvh));
+	return true;
+}
+
+// Loads a scene from objFile and mtlFile with loader (unloadTextureFile, unloadNewFile or unloadobjFile), going through
+// the binary cache at objFile + ".cache" so only the first run with these sources pays for parsing and building the BVH.
+Scene loadCachedScene(const string& objFile, const string& mtlFile, float scalingFactor, Mesh (*loader)(string, float, const MaterialTable&)) {
+	int loaderId = loader == unloadTextureFile ? 1 : loader == unloadNewFile ? 2 : 0;
+	uint64_t sourceHash = sceneSourceHash(objFile, mtlFile, scalingFactor, loaderId);
+	string cacheFile = objFile + ".cache";
+	Scene scene;
+	if (sourceHash != 0 && readSceneCache(cacheFile, sourceHash, scene)) return scene;
+
+	// only the smooth loader ever made Grey metal and Orange glass
+	MaterialTable materials = unloadMaterialFile(mtlFile, loader == unloadNewFile);
+	scene = buildScene(loader(objFile, scalingFactor, materials), materials);
+	if (sourceHash != 0) writeSceneCache(cacheFile, sourceHash, scene);
+	return scene;
+}
@@ -0,0 +1,162 @@
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+#include <cstring>
+#include <cstdint>
+
+// Thin wrapper over whichever float vector the compiler was told it can use, so the packet code is written once.
+// AVX2 gives 8 lanes, SSE2 gives 4, anything else falls back to plain arrays of 4.
+// Comparisons return masks with every bit of a lane set, to be combined with & and | and used by vselect.
+// vint is the matching vector of 32 bit ints (same lane count), for integer work like the rasterizer's edge functions.
+
+#if defined(__AVX2__)
+#define SIMD_WIDTH 8
+
+struct vfloat {
+	__m256 m;
+	vfloat() = default;
+	vfloat(__m256 value) : m(value) {}
+	vfloat(float value) : m(_mm256_set1_ps(value)) {}
+	static vfloat load(const float* p) { return _mm256_loadu_ps(p); }
+	void store(float* p) const { _mm256_storeu_ps(p, m); }
+};
+
+inline vfloat operator+(vfloat a, vfloat b) { return _mm256_add_ps(a.m, b.m); }
+inline vfloat operator-(vfloat a, vfloat b) { return _mm256_sub_ps(a.m, b.m); }
+inline vfloat operator*(vfloat a, vfloat b) { return _mm256_mul_ps(a.m, b.m); }
+inline vfloat operator/(vfloat a, vfloat b) { return _mm256_div_ps(a.m, b.m); }
+inline vfloat operator-(vfloat a) { return _mm256_xor_ps(a.m, _mm256_set1_ps(-0.0f)); }
+inline vfloat operator<(vfloat a, vfloat b) { return _mm256_cmp_ps(a.m, b.m, _CMP_LT_OQ); }
+inline vfloat operator<=(vfloat a, vfloat b) { return _mm256_cmp_ps(a.m, b.m, _CMP_LE_OQ); }
+inline vfloat operator>(vfloat a, vfloat b) { return _mm256_cmp_ps(a.m, b.m, _CMP_GT_OQ); }
+inline vfloat operator>=(vfloat a, vfloat b) { return _mm256_cmp_ps(a.m, b.m, _CMP_GE_OQ); }
+inline vfloat operator!=(vfloat a, vfloat b) { return _mm256_cmp_ps(a.m, b.m, _CMP_NEQ_OQ); }
+inline vfloat operator&(vfloat a, vfloat b) { return _mm256_and_ps(a.m, b.m); }
+inline vfloat operator|(vfloat a, vfloat b) { return _mm256_or_ps(a.m, b.m); }
+inline vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a.m, b.m); }
+inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a.m, b.m); }
+// lanes where mask is set take a, the rest take b
+inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b.m, a.m, mask.m); }
+// one bit per lane, set where the mask is
+inline int vmovemask(vfloat mask) { return _mm256_movemask_ps(mask.m); }
+
+struct vint {
+	__m256i m;
+	vint() = default;
+	vint(__m256i value) : m(value) {}
+	vint(int32_t value) : m(_mm256_set1_epi32(value)) {}
+	static vint load(const int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	void store(int32_t* p) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), m); }
+};
+
+inline vint operator+(vint a, vint b) { return _mm256_add_epi32(a.m, b.m); }
+inline vint operator&(vint a, vint b) { return _mm256_and_si256(a.m, b.m); }
+inline vint operator|(vint a, vint b) { return _mm256_or_si256(a.m, b.m); }
+inline vint operator>(vint a, vint b) { return _mm256_cmpgt_epi32(a.m, b.m); }
+// the same bits seen as the other type, so int and float masks can be combined
+inline vfloat asFloat(vint a) { return _mm256_castsi256_ps(a.m); }
+inline vint asInt(vfloat a) { return _mm256_castps_si256(a.m); }
+
+#elif defined(__SSE2__) || defined(_M_X64)
+#define SIMD_WIDTH 4
+
+struct vfloat {
+	__m128 m;
+	vfloat() = default;
+	vfloat(__m128 value) : m(value) {}
+	vfloat(float value) : m(_mm_set1_ps(value)) {}
+	static vfloat load(const float* p) { return _mm_loadu_ps(p); }
+	void store(float* p) const { _mm_storeu_ps(p, m); }
+};
+
+inline vfloat operator+(vfloat a, vfloat b) { return _mm_add_ps(a.m, b.m); }
+inline vfloat operator-(vfloat a, vfloat b) { return _mm_sub_ps(a.m, b.m); }
+inline vfloat operator*(vfloat a, vfloat b) { return _mm_mul_ps(a.m, b.m); }
+inline vfloat operator/(vfloat a, vfloat b) { return _mm_div_ps(a.m, b.m); }
+inline vfloat operator-(vfloat a) { return _mm_xor_ps(a.m, _mm_set1_ps(-0.0f)); }
+inline vfloat operator<(vfloat a, vfloat b) { return _mm_cmplt_ps(a.m, b.m); }
+inline vfloat operator<=(vfloat a, vfloat b) { return _mm_cmple_ps(a.m, b.m); }
+inline vfloat operator>(vfloat a, vfloat b) { return _mm_cmpgt_ps(a.m, b.m); }
+inline vfloat operator>=(vfloat a, vfloat b) { return _mm_cmpge_ps(a.m, b.m); }
+inline vfloat operator!=(vfloat a, vfloat b) { return _mm_and_ps(_mm_cmpneq_ps(a.m, b.m), _mm_cmpord_ps(a.m, b.m)); }
+inline vfloat operator&(vfloat a, vfloat b) { return _mm_and_ps(a.m, b.m); }
+inline vfloat operator|(vfloat a, vfloat b) { return _mm_or_ps(a.m, b.m); }
+inline vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a.m, b.m); }
+inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a.m, b.m); }
+inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask.m, a.m), _mm_andnot_ps(mask.m, b.m)); }
+inline int vmovemask(vfloat mask) { return _mm_movemask_ps(mask.m); }
+
+struct vint {
+	__m128i m;
+	vint() = default;
+	vint(__m128i value) : m(value) {}
+	vint(int32_t value) : m(_mm_set1_epi32(value)) {}
+	static vint load(const int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	void store(int32_t* p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), m); }
+};
+
+inline vint operator+(vint a, vint b) { return _mm_add_epi32(a.m, b.m); }
+inline vint operator&(vint a, vint b) { return _mm_and_si128(a.m, b.m); }
+inline vint operator|(vint a, vint b) { return _mm_or_si128(a.m, b.m); }
+inline vint operator>(vint a, vint b) { return _mm_cmpgt_epi32(a.m, b.m); }
+inline vfloat asFloat(vint a) { return _mm_castsi128_ps(a.m); }
+inline vint asInt(vfloat a) { return _mm_castps_si128(a.m); }
+
+#else
+#define SIMD_WIDTH 4
+
+struct vfloat {
+	float lanes[SIMD_WIDTH];
+	vfloat() = default;
+	vfloat(float value) { for (int i = 0; i < SIMD_WIDTH; i++) lanes[i] = value; }
+	static vfloat load(const float* p) { vfloat r; memcpy(r.lanes, p, sizeof(r.lanes)); return r; }
+	void store(float* p) const { memcpy(p, lanes, sizeof(lanes)); }
+};
+
+inline float laneMask(bool set) { uint32_t bits = set ? 0xFFFFFFFFu : 0; float f; memcpy(&f, &bits, 4); return f; }
+inline uint32_t laneBits(float f) { uint32_t bits; memcpy(&bits, &f, 4); return bits; }
+
+#define VFLOAT_LANEWISE(expression) vfloat r; for (int i = 0; i < SIMD_WIDTH; i++) r.lanes[i] = (expression); return r;
+inline vfloat operator+(vfloat a, vfloat b) { VFLOAT_LANEWISE(a.lanes[i] + b.lanes[i]) }
+inline vfloat operator-(vfloat a, vfloat b) { VFLOAT_LANEWISE(a.lanes[i] - b.lanes[i]) }
+inline vfloat operator*(vfloat a, vfloat b) { VFLOAT_LANEWISE(a.lanes[i] * b.lanes[i]) }
+inline vfloat operator/(vfloat a, vfloat b) { VFLOAT_LANEWISE(a.lanes[i] / b.lanes[i]) }
+inline vfloat operator-(vfloat a) { VFLOAT_LANEWISE(-a.lanes[i]) }
+inline vfloat operator<(vfloat a, vfloat b) { VFLOAT_LANEWISE(laneMask(a.lanes[i] < b.lanes[i])) }
+inline vfloat operator<=(vfloat a, vfloat b) { VFLOAT_LANEWISE(laneMask(a.lanes[i] <= b.lanes[i])) }
+inline vfloat operator>(vfloat a, vfloat b) { VFLOAT_LANEWISE(laneMask(a.lanes[i] > b.lanes[i])) }
+inline vfloat operator>=(vfloat a, vfloat b) { VFLOAT_LANEWISE(laneMask(a.lanes[i] >= b.lanes[i])) }
+inline vfloat operator!=(vfloat a, vfloat b) { VFLOAT_LANEWISE(laneMask(a.lanes[i] < b.lanes[i] || a.lanes[i] > b.lanes[i])) }
+inline vfloat operator&(vfloat a, vfloat b) { VFLOAT_LANEWISE(laneMask(laneBits(a.lanes[i]) & laneBits(b.lanes[i]))) }
+inline vfloat operator|(vfloat a, vfloat b) { VFLOAT_LANEWISE(laneMask(laneBits(a.lanes[i]) | laneBits(b.lanes[i]))) }
+inline vfloat vmin(vfloat a, vfloat b) { VFLOAT_LANEWISE(b.lanes[i] < a.lanes[i] ? b.lanes[i] : a.lanes[i]) }
+inline vfloat vmax(vfloat a, vfloat b) { VFLOAT_LANEWISE(b.lanes[i] > a.lanes[i] ? b.lanes[i] : a.lanes[i]) }
+inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { VFLOAT_LANEWISE(laneBits(mask.lanes[i]) ? a.lanes[i] : b.lanes[i]) }
+inline int vmovemask(vfloat mask) {
+	int bits = 0;
+	for (int i = 0; i < SIMD_WIDTH; i++) if (laneBits(mask.lanes[i])) bits |= 1 << i;
+	return bits;
+}
+
+struct vint {
+	int32_t lanes[SIMD_WIDTH];
+	vint() = default;
+	vint(int32_t value) { for (int i = 0; i < SIMD_WIDTH; i++) lanes[i] = value; }
+	static vint load(const int32_t* p) { vint r; memcpy(r.lanes, p, sizeof(r.lanes)); return r; }
+	void store(int32_t* p) const { memcpy(p, lanes, sizeof(lanes)); }
+};
+
+// adds wrap around like the vector instructions do, rather than overflowing
+#define VINT_LANEWISE(expression) vint r; for (int i = 0; i < SIMD_WIDTH; i++) r.lanes[i] = (expression); return r;
+inline vint operator+(vint a, vint b) { VINT_LANEWISE((int32_t)((uint32_t)a.lanes[i] + (uint32_t)b.lanes[i])) }
+inline vint operator&(vint a, vint b) { VINT_LANEWISE(a.lanes[i] & b.lanes[i]) }
+inline vint operator|(vint a, vint b) { VINT_LANEWISE(a.lanes[i] | b.lanes[i]) }
+inline vint operator>(vint a, vint b) { VINT_LANEWISE(a.lanes[i] > b.lanes[i] ? -1 : 0) }
+inline vfloat asFloat(vint a) { vfloat r; memcpy(r.lanes, a.lanes, sizeof(r.lanes)); return r; }
+inline vint asInt(vfloat a) { vint r; memcpy(r.lanes, a.lanes, sizeof(r.lanes)); return r; }
+#undef VINT_LANEWISE
+#undef VFLOAT_LANEWISE
+#endif
+
+// lanes where mask is set take a, the rest take b
+inline vint vselect(vint mask, vint a, vint b) { return asInt(vselect(asFloat(mask), asFloat(a), asFloat(b))); }
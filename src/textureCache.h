@@ -0,0 +1,71 @@
+#include <map>
+
+using namespace std;
+using namespace glm;
+
+// read-only look at a loaded texture, pixels are row-major so texel (x, y) is pixels[x + y * width]
+struct TextureView {
+	const uint32_t* pixels = nullptr;
+	int width = 0;
+	int height = 0;
+
+	bool empty() const {
+		return pixels == nullptr;
+	}
+
+	// texel at (x, y) with both clamped to the edges of the texture
+	uint32_t at(int x, int y) const {
+		x = std::min(std::max(x, 0), width - 1);
+		y = std::min(std::max(y, 0), height - 1);
+		return pixels[x + y * width];
+	}
+
+	// texel under texel coordinates (x, y) (texel (i, j) covering [i, i + 1) x [j, j + 1)), outside the texture either
+	// clamped to its edges or repeating it, as wrap (TEXTURE_CLAMP or TEXTURE_REPEAT) says
+	uint32_t sample(float x, float y, int wrap) const {
+		if (wrap == TEXTURE_REPEAT) {
+			x -= std::floor(x / width) * width;
+			y -= std::floor(y / height) * height;
+		}
+		// written so NaN (from a pixel the triangle does not really cover) ends up at 0 too
+		x = x > 0 ? std::min(x, width - 1.0f) : 0;
+		y = y > 0 ? std::min(y, height - 1.0f) : 0;
+		return pixels[(int)x + (int)y * width];
+	}
+};
+
+// Every texture a scene uses, each file is read once when the scene is built and shared by all triangles after that.
+// Textures are handed out by handle (position in the cache) so materials can refer to them with an int.
+struct TextureCache {
+	vector<TextureMap> textures;
+	map<string, int> handles;
+
+	// handle of the texture at path, loading it the first time it is asked for
+	// a file that cannot be read gets an empty texture so triangles using it fall back to their flat colour
+	int load(const string& path) {
+		auto found = handles.find(path);
+		if (found != handles.end()) return found->second;
+		TextureMap texture;
+		try {
+			texture = TextureMap(path);
+		}
+		catch (const std::exception& error) {
+			std::cout << "could not load texture " << path << ": " << error.what() << std::endl;
+			texture.width = 0;
+			texture.height = 0;
+		}
+		textures.push_back(std::move(texture));
+		handles[path] = textures.size() - 1;
+		return textures.size() - 1;
+	}
+
+	// empty view for handle -1 or a texture that failed to load
+	TextureView view(int handle) const {
+		TextureView view;
+		if (handle < 0 || handle >= (int)textures.size() || textures[handle].pixels.empty()) return view;
+		view.pixels = textures[handle].pixels.data();
+		view.width = textures[handle].width;
+		view.height = textures[handle].height;
+		return view;
+	}
+};
@@ -0,0 +1,136 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+using namespace std;
+
+// indices still to be done by one participant, the owner takes from the front and thieves take from the back
+struct WorkRange {
+	std::mutex lock;
+	int next = 0;
+	int end = 0;
+};
+
+// Fixed set of worker threads for splitting a loop across cores.
+// parallelFor gives every participant (the workers plus the calling thread) an equal slice of the indices,
+// anyone who finishes early steals from the back of the other slices, so uneven work still balances.
+// Nothing is allocated per call, the job is passed around as a function pointer and context.
+class ThreadPool {
+	vector<thread> workers;
+	vector<unique_ptr<WorkRange>> ranges;
+
+	std::mutex jobLock;
+	condition_variable jobReady;
+	condition_variable jobDone;
+	int generation = 0;
+	int busyWorkers = 0;
+	bool stopping = false;
+
+	void (*jobFunction)(const void*, int) = nullptr;
+	const void* jobContext = nullptr;
+
+	bool takeIndex(int slot, int& index) {
+		WorkRange& own = *ranges[slot];
+		{
+			lock_guard<std::mutex> guard(own.lock);
+			if (own.next < own.end) {
+				index = own.next++;
+				return true;
+			}
+		}
+		for (size_t k = 1; k < ranges.size(); k++) {
+			WorkRange& victim = *ranges[(slot + k) % ranges.size()];
+			lock_guard<std::mutex> guard(victim.lock);
+			if (victim.next < victim.end) {
+				index = --victim.end;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void runJob(int slot) {
+		int index;
+		while (takeIndex(slot, index)) jobFunction(jobContext, index);
+	}
+
+	void workerLoop(int slot) {
+		int seen = 0;
+		while (true) {
+			{
+				unique_lock<std::mutex> guard(jobLock);
+				jobReady.wait(guard, [&] { return stopping || generation != seen; });
+				if (stopping) return;
+				seen = generation;
+			}
+			runJob(slot);
+			lock_guard<std::mutex> guard(jobLock);
+			if (--busyWorkers == 0) jobDone.notify_one();
+		}
+	}
+
+	void stop() {
+		{
+			lock_guard<std::mutex> guard(jobLock);
+			stopping = true;
+		}
+		jobReady.notify_all();
+		for (thread& worker : workers) worker.join();
+		workers.clear();
+		stopping = false;
+	}
+
+public:
+	ThreadPool(int threadCount) {
+		resize(threadCount);
+	}
+
+	~ThreadPool() {
+		stop();
+	}
+
+	// total number of threads used by parallelFor, including the one calling it
+	int size() const {
+		return ranges.size();
+	}
+
+	void resize(int threadCount) {
+		stop();
+		threadCount = std::max(threadCount, 1);
+		ranges.clear();
+		for (int i = 0; i < threadCount; i++) ranges.push_back(unique_ptr<WorkRange>(new WorkRange()));
+		// the calling thread always takes the last slot
+		for (int i = 0; i < threadCount - 1; i++) workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+	}
+
+	// calls function(i) for every i in [0, count) and returns once they have all finished
+	template <typename Function>
+	void parallelFor(int count, const Function& function) {
+		if (workers.empty() || count <= 1) {
+			for (int i = 0; i < count; i++) function(i);
+			return;
+		}
+		int participants = ranges.size();
+		for (int p = 0; p < participants; p++) {
+			lock_guard<std::mutex> guard(ranges[p]->lock);
+			ranges[p]->next = (long long)count * p / participants;
+			ranges[p]->end = (long long)count * (p + 1) / participants;
+		}
+		jobFunction = [](const void* context, int index) { (*static_cast<const Function*>(context))(index); };
+		jobContext = &function;
+		{
+			lock_guard<std::mutex> guard(jobLock);
+			busyWorkers = workers.size();
+			generation++;
+		}
+		jobReady.notify_all();
+
+		runJob(participants - 1);
+		unique_lock<std::mutex> guard(jobLock);
+		jobDone.wait(guard, [&] { return busyWorkers == 0; });
+	}
+};
+
+// shared by every renderer, defaults to one thread per core and can be changed with --threads N
+ThreadPool threadPool(thread::hardware_concurrency());
@@ -0,0 +1,423 @@
+using namespace std;
+using namespace glm;
+
+// side of the square blocks of pixels tested against a triangle's edges at once, which are also the depth buffer's tiles
+#define RASTER_BLOCK 8
+
+// 1/depth of the closest surface drawn so far at every pixel of the window (0 where nothing is), larger is closer.
+// Each program keeps one next to the frame it draws into, and every draw call sizes it to that frame with match.
+// One row-major array matching the window's pixel buffer, so a scanline walks contiguous memory and clearing is a single fill.
+// Every RASTER_BLOCK square tile also keeps the range of 1/depth in it, so a triangle can be thrown out (or let straight
+// through) for a whole tile without reading its pixels.
+// A buffer can also cover just a rectangle of the screen starting at (originX, originY), which must then be a multiple
+// of RASTER_BLOCK so its tiles line up with the window's. Pixels are always addressed by their position on the screen.
+struct DepthBuffer {
+	vector<float> depths;
+	int originX = 0;
+	int originY = 0;
+	int width = 0;
+	int height = 0;
+	// per tile, row-major: bounds on the farthest (smallest) and closest (largest) 1/depth of any pixel in it,
+	// never above and never below the real values respectively
+	vector<float> tileFarthest;
+	vector<float> tileNearest;
+	int tilesX = 0;
+
+	// only reallocates (and clears) when the size changed
+	void resize(int newWidth, int newHeight) {
+		if (width == newWidth && height == newHeight) return;
+		width = newWidth;
+		height = newHeight;
+		tilesX = (width + RASTER_BLOCK - 1) / RASTER_BLOCK;
+		int tilesY = (height + RASTER_BLOCK - 1) / RASTER_BLOCK;
+		depths.assign(width * height, 0);
+		tileFarthest.assign(tilesX * tilesY, 0);
+		tileNearest.assign(tilesX * tilesY, 0);
+	}
+
+	// sizes the buffer to cover all of window
+	void match(const FrameBuffer& window) {
+		originX = 0;
+		originY = 0;
+		resize(window.width, window.height);
+	}
+
+	void clear() {
+		std::fill(depths.begin(), depths.end(), 0.0f);
+		std::fill(tileFarthest.begin(), tileFarthest.end(), 0.0f);
+		std::fill(tileNearest.begin(), tileNearest.end(), 0.0f);
+	}
+
+	int index(int x, int y) const {
+		return (x - originX) + (y - originY) * width;
+	}
+
+	float& at(int x, int y) {
+		return depths[index(x, y)];
+	}
+
+	// tile holding pixel (x, y)
+	int tile(int x, int y) const {
+		return (x - originX) / RASTER_BLOCK + (y - originY) / RASTER_BLOCK * tilesX;
+	}
+
+	// copies this buffer's pixels and tile bounds into the same place in target, which must cover all of them
+	void storeInto(DepthBuffer& target) const {
+		for (int y = originY; y < originY + height; y++) {
+			std::copy_n(&depths[index(originX, y)], width, &target.at(originX, y));
+		}
+		for (int y = originY; y < originY + height; y += RASTER_BLOCK) {
+			for (int x = originX; x < originX + width; x += RASTER_BLOCK) {
+				target.tileFarthest[target.tile(x, y)] = tileFarthest[tile(x, y)];
+				target.tileNearest[target.tile(x, y)] = tileNearest[tile(x, y)];
+			}
+		}
+	}
+};
+
+// Vertex positions are snapped to 1/16th of a pixel for the edge functions, so they are exact integers
+// and two triangles sharing an edge agree on which side of it every pixel lies.
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+// triangles reaching further than this many pixels off screen are not drawn, keeping edge setup well inside int64
+#define RASTER_GUARD_BAND (1 << 24)
+// relative slack when comparing a triangle's 1/depth range against a tile's, covering the float rounding
+// of the per pixel values so the coarse test never throws out a pixel the per pixel test would have drawn
+#define TILE_DEPTH_SLACK 1e-5f
+// triangles whose bounding box has at most this many pixels are walked one pixel at a time, they cost more
+// to set up for the SIMD tiles than their few pixels take
+#define RASTER_SMALL_TRIANGLE 32
+
+// One edge of a triangle as a function of the pixel, not negative on the side the triangle is on.
+// Pixel centres sit on integer coordinates (like the rounding in getCanvasIntersectionPoint) and stepping one pixel
+// right or down just adds stepX or stepY, so rasterizing never recomputes it from scratch.
+struct EdgeFunction {
+	int64_t origin;
+	int64_t stepX;
+	int64_t stepY;
+
+	EdgeFunction() = default;
+
+	// edge from a to b in fixed point, with the triangle on the side where (b - a) x (p - a) is positive
+	EdgeFunction(int64_t ax, int64_t ay, int64_t bx, int64_t by) {
+		int64_t dx = bx - ax;
+		int64_t dy = by - ay;
+		stepX = -dy * SUBPIXEL_ONE;
+		stepY = dx * SUBPIXEL_ONE;
+		// top-left rule: a pixel centre exactly on an edge belongs to the triangle only if it is a top or left edge,
+		// so of two triangles sharing the edge exactly one draws it
+		bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+		origin = dy * ax - dx * ay - (topLeft ? 0 : 1);
+	}
+
+	int64_t at(int x, int y) const {
+		return origin + stepX * x + stepY * y;
+	}
+};
+
+// a triangle set up for the edge function rasterizer, covering pixels minX to maxX and minY to maxY (inclusive)
+struct RasterTriangle {
+	EdgeFunction edges[3];
+	// 1/depth at pixel (x, y) is inverseDepth + inverseDepthX * x + inverseDepthY * y, linear in screen space
+	double inverseDepth;
+	double inverseDepthX;
+	double inverseDepthY;
+	// largest 1/depth anywhere on the triangle (at one of its corners)
+	float nearest;
+	int minX, minY, maxX, maxY;
+
+	float inverseDepthAt(int x, int y) const {
+		return inverseDepth + inverseDepthX * x + inverseDepthY * y;
+	}
+};
+
+// A triangle in one colour. The shades are what rasterizeTriangle asks for the colour of covered pixels, at is one pixel
+// (with the triangle's 1/depth there) and row is SIMD_WIDTH pixels of a row starting at (x, y).
+struct FlatShade {
+	uint32_t colour;
+
+	uint32_t at(int x, int y, float inverseDepth) const {
+		return colour;
+	}
+
+	vint row(int x, int y, vfloat inverseDepth) const {
+		int32_t bits;
+		memcpy(&bits, &colour, sizeof(int32_t));
+		return vint(bits);
+	}
+};
+
+// A texture mapped with perspective correction. Texture coordinates do not vary linearly across the screen but
+// coordinate / depth does (like 1 / depth), so those planes are interpolated and divided by 1/depth at each pixel.
+// Coordinates are in texels, set up by setupRasterTriangle from the corners' texture points.
+struct TextureShade {
+	TextureView texture;
+	int wrap = TEXTURE_CLAMP;
+	// u/depth at pixel (x, y) is u + uX * x + uY * y, the same for v
+	double u, uX, uY;
+	double v, vX, vY;
+
+	uint32_t at(int x, int y, float inverseDepth) const {
+		return texture.sample((float)(u + uX * x + uY * y) / inverseDepth, (float)(v + vX * x + vY * y) / inverseDepth, wrap);
+	}
+
+	vint row(int x, int y, vfloat inverseDepth) const {
+		float lanes[SIMD_WIDTH];
+		for (int lane = 0; lane < SIMD_WIDTH; lane++) lanes[lane] = lane;
+		vfloat offsets = vfloat::load(lanes);
+		float us[SIMD_WIDTH], vs[SIMD_WIDTH];
+		((vfloat((float)(u + uX * x + uY * y)) + vfloat((float)uX) * offsets) / inverseDepth).store(us);
+		((vfloat((float)(v + vX * x + vY * y)) + vfloat((float)vX) * offsets) / inverseDepth).store(vs);
+		int32_t texels[SIMD_WIDTH];
+		for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+			uint32_t texel = texture.sample(us[lane], vs[lane], wrap);
+			memcpy(&texels[lane], &texel, sizeof(int32_t));
+		}
+		return vint::load(texels);
+	}
+};
+
+// Sets up the triangle between 3 projected points (depth being the camera space z) for a width x height screen.
+// False if it covers no pixel, has no area or reaches too far off screen. Either winding is drawn.
+// With texture, also sets up its planes from the corners' texture points (in texels).
+bool setupRasterTriangle(CanvasPoint v0, CanvasPoint v1, CanvasPoint v2, int width, int height, RasterTriangle& triangle, TextureShade* texture = nullptr) {
+	CanvasPoint points[3] = { v0, v1, v2 };
+	int64_t x[3], y[3];
+	for (int k = 0; k < 3; k++) {
+		if (!(abs(points[k].x) < RASTER_GUARD_BAND && abs(points[k].y) < RASTER_GUARD_BAND)) return false;
+		x[k] = llround(points[k].x * SUBPIXEL_ONE);
+		y[k] = llround(points[k].y * SUBPIXEL_ONE);
+	}
+	int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (area == 0) return false;
+	if (area < 0) {
+		std::swap(points[1], points[2]);
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		area = -area;
+	}
+
+	// smallest pixel centre at or after the lowest vertex to the largest at or before the highest, clipped to the screen
+	triangle.minX = std::max<int64_t>(0, (std::min({ x[0], x[1], x[2] }) + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS);
+	triangle.minY = std::max<int64_t>(0, (std::min({ y[0], y[1], y[2] }) + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS);
+	triangle.maxX = std::min<int64_t>(width - 1, std::max({ x[0], x[1], x[2] }) >> SUBPIXEL_BITS);
+	triangle.maxY = std::min<int64_t>(height - 1, std::max({ y[0], y[1], y[2] }) >> SUBPIXEL_BITS);
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return false;
+
+	// edge k is opposite vertex k, so edge k divided by the area is vertex k's barycentric weight
+	for (int k = 0; k < 3; k++) {
+		int a = (k + 1) % 3;
+		int b = (k + 2) % 3;
+		triangle.edges[k] = EdgeFunction(x[a], y[a], x[b], y[b]);
+	}
+
+	// 1/depth is what varies linearly across the screen, weighting it by the edges (without the fill rule bias) gives its plane
+	triangle.inverseDepth = 0;
+	triangle.inverseDepthX = 0;
+	triangle.inverseDepthY = 0;
+	for (int k = 0; k < 3; k++) {
+		int a = (k + 1) % 3;
+		int b = (k + 2) % 3;
+		double inverseDepth = 1 / abs(points[k].depth);
+		triangle.inverseDepth += inverseDepth * ((y[b] - y[a]) * x[a] - (x[b] - x[a]) * y[a]);
+		triangle.inverseDepthX += inverseDepth * triangle.edges[k].stepX;
+		triangle.inverseDepthY += inverseDepth * triangle.edges[k].stepY;
+	}
+	triangle.inverseDepth /= area;
+	triangle.inverseDepthX /= area;
+	triangle.inverseDepthY /= area;
+	// points without a depth (like the random triangles, at depth 0) are in front of everything, all over the triangle
+	if (!isfinite(triangle.inverseDepth) || !isfinite(triangle.inverseDepthX) || !isfinite(triangle.inverseDepthY)) {
+		triangle.inverseDepth = 1 / abs(points[0].depth);
+		triangle.inverseDepthX = 0;
+		triangle.inverseDepthY = 0;
+	}
+	triangle.nearest = std::max({ 1 / abs(points[0].depth), 1 / abs(points[1].depth), 1 / abs(points[2].depth) });
+
+	if (texture) {
+		double planes[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+		for (int k = 0; k < 3; k++) {
+			int a = (k + 1) % 3;
+			int b = (k + 2) % 3;
+			double inverseDepth = 1 / abs(points[k].depth);
+			double corner[2] = { points[k].texturePoint.x * inverseDepth, points[k].texturePoint.y * inverseDepth };
+			for (int c = 0; c < 2; c++) {
+				planes[c][0] += corner[c] * ((y[b] - y[a]) * x[a] - (x[b] - x[a]) * y[a]);
+				planes[c][1] += corner[c] * triangle.edges[k].stepX;
+				planes[c][2] += corner[c] * triangle.edges[k].stepY;
+			}
+		}
+		texture->u = planes[0][0] / area;
+		texture->uX = planes[0][1] / area;
+		texture->uY = planes[0][2] / area;
+		texture->v = planes[1][0] / area;
+		texture->vX = planes[1][1] / area;
+		texture->vY = planes[1][2] / area;
+		// points without a depth get the first corner's texture point all over, like their 1/depth
+		if (!isfinite(texture->u) || !isfinite(texture->uX) || !isfinite(texture->uY)
+			|| !isfinite(texture->v) || !isfinite(texture->vX) || !isfinite(texture->vY)) {
+			texture->u = points[0].texturePoint.x * triangle.inverseDepth;
+			texture->v = points[0].texturePoint.y * triangle.inverseDepth;
+			texture->uX = texture->uY = texture->vX = texture->vY = 0;
+		}
+	}
+	return true;
+}
+
+// one pixel of triangle at a time over pixels firstX to lastX and firstY to lastY, where start is the edge functions at
+// (firstX, firstY), true if any pixel was drawn
+template <typename Shade>
+bool rasterizeBlockScalar(const RasterTriangle& triangle, const Shade& shade, uint32_t* pixels, int stride, DepthBuffer& depth, int firstX, int lastX, int firstY, int lastY, const int64_t* start) {
+	const EdgeFunction* edges = triangle.edges;
+	float inverseDepthX = triangle.inverseDepthX;
+	int64_t row[3] = { start[0], start[1], start[2] };
+	bool drawn = false;
+	for (int y = firstY; y <= lastY; y++) {
+		int64_t w0 = row[0], w1 = row[1], w2 = row[2];
+		float inverseDepth = triangle.inverseDepthAt(firstX, y);
+		float* depthRow = &depth.at(firstX, y);
+		uint32_t* pixelRow = &pixels[y * stride + firstX];
+		for (int i = 0; i <= lastX - firstX; i++) {
+			// all three are not negative exactly when or-ing them leaves the sign bit clear
+			if ((w0 | w1 | w2) >= 0 && inverseDepth > depthRow[i]) {
+				depthRow[i] = inverseDepth;
+				pixelRow[i] = shade.at(firstX + i, y, inverseDepth);
+				drawn = true;
+				PROFILE_COUNT(COUNTER_FRAGMENTS, 1);
+			}
+			w0 += edges[0].stepX;
+			w1 += edges[1].stepX;
+			w2 += edges[2].stepX;
+			inverseDepth += inverseDepthX;
+		}
+		for (int k = 0; k < 3; k++) row[k] += edges[k].stepY;
+	}
+	return drawn;
+}
+
+// Fills triangle with shade (FlatShade or TextureShade) wherever it is closer than what depth already holds, writing straight into pixels
+// (a row-major buffer for the whole screen, stride pixels wide). Only the part of the triangle inside depth's rectangle is
+// drawn, working through the depth buffer's tiles under the bounding box:
+// - a tile entirely outside an edge is skipped, and edges it is entirely inside are not tested per pixel
+// - a tile whose farthest pixel is closer than the triangle's nearest point there is skipped (hierarchical z),
+//   one whose nearest pixel is farther than all of the triangle skips the per pixel depth test
+// - the rest is done SIMD_WIDTH pixels of a row at a time, with the edge functions as 32 bit ints stepped down the tile
+//   (falling back to one pixel at a time for the odd tile of a huge triangle whose values do not fit)
+// Small triangles skip all of that and just walk their bounding box.
+template <typename Shade>
+void rasterizeTriangle(const RasterTriangle& triangle, const Shade& shade, uint32_t* pixels, int stride, DepthBuffer& depth) {
+	const EdgeFunction* edges = triangle.edges;
+	int minX = std::max(triangle.minX, depth.originX);
+	int minY = std::max(triangle.minY, depth.originY);
+	int maxX = std::min(triangle.maxX, depth.originX + depth.width - 1);
+	int maxY = std::min(triangle.maxY, depth.originY + depth.height - 1);
+	if (minX > maxX || minY > maxY) return;
+	if ((maxX - minX + 1) * (maxY - minY + 1) <= RASTER_SMALL_TRIANGLE) {
+		int64_t start[3];
+		for (int k = 0; k < 3; k++) start[k] = edges[k].at(minX, minY);
+		if (!rasterizeBlockScalar(triangle, shade, pixels, stride, depth, minX, maxX, minY, maxY, start)) return;
+		// keeps the closest bound of every tile it may have drawn in
+		for (int y = minY - minY % RASTER_BLOCK; y <= maxY; y += RASTER_BLOCK) {
+			for (int x = minX - minX % RASTER_BLOCK; x <= maxX; x += RASTER_BLOCK) {
+				float& tileNearest = depth.tileNearest[depth.tile(x, y)];
+				tileNearest = std::max(tileNearest, triangle.nearest * (1 + TILE_DEPTH_SLACK));
+			}
+		}
+		return;
+	}
+
+	// edge functions and 1/depth at each pixel of a tile row relative to its first, one vector per SIMD_WIDTH pixels
+	static_assert(RASTER_BLOCK % SIMD_WIDTH == 0, "tile rows are done in whole vectors");
+	const int vectorsPerRow = RASTER_BLOCK / SIMD_WIDTH;
+	vint laneEdges[3][vectorsPerRow];
+	vfloat laneDepths[vectorsPerRow];
+	for (int v = 0; v < vectorsPerRow; v++) {
+		int32_t lanes[SIMD_WIDTH];
+		float depthLanes[SIMD_WIDTH];
+		for (int k = 0; k < 3; k++) {
+			// may wrap around for huge triangles, which is harmless as only tiles whose values fit in 32 bits use them
+			for (int lane = 0; lane < SIMD_WIDTH; lane++) lanes[lane] = (int32_t)(edges[k].stepX * (v * SIMD_WIDTH + lane));
+			laneEdges[k][v] = vint::load(lanes);
+		}
+		for (int lane = 0; lane < SIMD_WIDTH; lane++) depthLanes[lane] = (float)triangle.inverseDepthX * (v * SIMD_WIDTH + lane);
+		laneDepths[v] = vfloat::load(depthLanes);
+	}
+	vfloat rowStepDepth((float)triangle.inverseDepthY);
+
+	for (int blockY = minY - minY % RASTER_BLOCK; blockY <= maxY; blockY += RASTER_BLOCK) {
+		int lastY = std::min(blockY + RASTER_BLOCK - 1, depth.originY + depth.height - 1);
+		for (int blockX = minX - minX % RASTER_BLOCK; blockX <= maxX; blockX += RASTER_BLOCK) {
+			int lastX = std::min(blockX + RASTER_BLOCK - 1, depth.originX + depth.width - 1);
+
+			// an edge function is linear, so over the tile it is largest and smallest at opposite corners
+			int64_t start[3];
+			bool outside = false;
+			bool inside[3];
+			bool fits = true;
+			for (int k = 0; k < 3; k++) {
+				start[k] = edges[k].at(blockX, blockY);
+				int64_t acrossX = edges[k].stepX * (lastX - blockX);
+				int64_t acrossY = edges[k].stepY * (lastY - blockY);
+				int64_t largest = start[k] + std::max<int64_t>(acrossX, 0) + std::max<int64_t>(acrossY, 0);
+				int64_t smallest = start[k] + std::min<int64_t>(acrossX, 0) + std::min<int64_t>(acrossY, 0);
+				if (largest < 0) outside = true;
+				inside[k] = smallest >= 0;
+				if (!inside[k] && (smallest < INT32_MIN || largest > INT32_MAX)) fits = false;
+			}
+			if (outside) continue;
+
+			// so is 1/depth
+			float corners[4] = { triangle.inverseDepthAt(blockX, blockY), triangle.inverseDepthAt(lastX, blockY),
+				triangle.inverseDepthAt(blockX, lastY), triangle.inverseDepthAt(lastX, lastY) };
+			float nearest = std::max({ corners[0], corners[1], corners[2], corners[3] });
+			float farthest = std::min({ corners[0], corners[1], corners[2], corners[3] });
+			int tile = depth.tile(blockX, blockY);
+			if (nearest * (1 + TILE_DEPTH_SLACK) <= depth.tileFarthest[tile]) continue;
+			bool inFront = farthest * (1 - TILE_DEPTH_SLACK) > depth.tileNearest[tile];
+
+			bool drawn = false;
+			if (!fits || lastX - blockX + 1 != RASTER_BLOCK) {
+				// huge triangles and the last tile of a row when the screen width is not a multiple of RASTER_BLOCK
+				drawn = rasterizeBlockScalar(triangle, shade, pixels, stride, depth, blockX, lastX, blockY, lastY, start);
+			}
+			else {
+				// rows outside the bounding box cannot be covered, small triangles often only touch a few
+				int firstRow = std::max(blockY, minY);
+				int lastRow = std::min(lastY, maxY);
+				vint row[3], rowStep[3], test[3];
+				for (int k = 0; k < 3; k++) {
+					row[k] = vint((int32_t)(start[k] + edges[k].stepY * (firstRow - blockY)));
+					rowStep[k] = vint((int32_t)edges[k].stepY);
+					// an edge the whole tile is inside of is masked to 0, which always passes
+					test[k] = vint(inside[k] ? 0 : -1);
+				}
+				vfloat rowDepth(triangle.inverseDepthAt(blockX, firstRow));
+				for (int y = firstRow; y <= lastRow; y++) {
+					float* depthRow = &depth.at(blockX, y);
+					int32_t* pixelRow = reinterpret_cast<int32_t*>(&pixels[y * stride + blockX]);
+					for (int v = 0; v < vectorsPerRow; v++) {
+						vint w = ((row[0] + laneEdges[0][v]) & test[0]) | ((row[1] + laneEdges[1][v]) & test[1]) | ((row[2] + laneEdges[2][v]) & test[2]);
+						vfloat covered = asFloat(w > vint(-1));
+						vfloat inverseDepth = rowDepth + laneDepths[v];
+						vfloat old = vfloat::load(&depthRow[v * SIMD_WIDTH]);
+						vfloat mask = inFront ? covered : covered & (inverseDepth > old);
+						if (int lanes = vmovemask(mask)) {
+							vselect(mask, inverseDepth, old).store(&depthRow[v * SIMD_WIDTH]);
+							vselect(asInt(mask), shade.row(blockX + v * SIMD_WIDTH, y, inverseDepth), vint::load(&pixelRow[v * SIMD_WIDTH])).store(&pixelRow[v * SIMD_WIDTH]);
+							drawn = true;
+							PROFILE_COUNT(COUNTER_FRAGMENTS, maskCount(lanes));
+						}
+					}
+					for (int k = 0; k < 3; k++) row[k] = row[k] + rowStep[k];
+					rowDepth = rowDepth + rowStepDepth;
+				}
+			}
+			// Pixels only ever get closer, so the tile's farthest value stays a safe bound without rereading the tile.
+			// If the triangle covered all of it, every pixel is now at least as close as the triangle's farthest point.
+			if (drawn) {
+				depth.tileNearest[tile] = std::max(depth.tileNearest[tile], nearest * (1 + TILE_DEPTH_SLACK));
+				if (inside[0] && inside[1] && inside[2]) depth.tileFarthest[tile] = std::max(depth.tileFarthest[tile], farthest * (1 - TILE_DEPTH_SLACK));
+			}
+		}
+	}
+}
@@ -1,11 +1,10 @@
 using namespace std;
 using namespace glm;
 
-#define WIDTH 640
-#define HEIGHT 480
-
 // Draws a line from point a to b
-void drawLine(DrawingWindow& window, CanvasPoint to, CanvasPoint from, uint32_t colour = convertColour(Colour(255, 255, 255))) {
+void drawLine(FrameBuffer& window, CanvasPoint to, CanvasPoint from, uint32_t colour = convertColour(Colour(255, 255, 255))) {
+	int width = window.width;
+	int height = window.height;
 	float numberOfSteps = std::max(abs(to.x - from.x), abs(to.y - from.y));
 	float xStep = (to.x - from.x) / numberOfSteps;
 	float yStep = (to.y - from.y) / numberOfSteps;
@@ -14,12 +13,12 @@ void drawLine(DrawingWindow& window, CanvasPoint to, CanvasPoint from, uint32_t
 		int x = round(from.x + (xStep * i));
 		int y = round(from.y + (yStep * i));
 		// check if pixel isn't out of bounds
-		if (x < WIDTH && x > 0 && y > 0 && y < HEIGHT) window.setPixelColour(round(x), round(y), colour);
+		if (x < width && x > 0 && y > 0 && y < height) window.setPixelColour(x, y, colour);
 	}
 }
 
 // Draws a triangle with only an outline
-void drawStrokedTriangle(DrawingWindow& window, CanvasTriangle triangle, Colour colour) {
+void drawStrokedTriangle(FrameBuffer& window, CanvasTriangle triangle, Colour colour) {
 	uint32_t newColour = convertColour(colour);
 	drawLine(window, triangle.v0(), triangle.v1(), newColour);
 	drawLine(window, triangle.v0(), triangle.v2(), newColour);
@@ -27,17 +26,20 @@ void drawStrokedTriangle(DrawingWindow& window, CanvasTriangle triangle, Colour
 }
 
 // Generates a random triangle with just an outline
-void randomStrokedTriangle(DrawingWindow& window) {
-	drawStrokedTriangle(window, generateRandomTriangle(), Colour{ rand() % 256, rand() % 256, rand() % 256 });
+void randomStrokedTriangle(FrameBuffer& window) {
+	drawStrokedTriangle(window, generateRandomTriangle(window.width, window.height), Colour{ rand() % 256, rand() % 256, rand() % 256 });
 }
 
 // renders scene using wire frames
-void renderWireFrame(DrawingWindow& window, vector<ModelTriangle> triangles, vec3 cameraPos, float focalLength, float scaleFactor, mat3 cameraOrientation) {
+void renderWireFrame(FrameBuffer& window, const Scene& scene, vec3 cameraPos, float focalLength, float scaleFactor, mat3 cameraOrientation) {
+	PROFILE_FRAME("wireframe frame");
+	const Mesh& mesh = scene.mesh;
+	static vector<CanvasPoint> projected;
+	projectVertices(mesh, cameraPos, focalLength, scaleFactor, cameraOrientation, window.width, window.height, projected);
 	window.clearPixels();
-	for (int i = 0; i < triangles.size(); i++) {
-		CanvasPoint pos0 = getCanvasIntersectionPoint(cameraPos, triangles[i].vertices[0], focalLength, scaleFactor, cameraOrientation);
-		CanvasPoint pos1 = getCanvasIntersectionPoint(cameraPos, triangles[i].vertices[1], focalLength, scaleFactor, cameraOrientation);
-		CanvasPoint pos2 = getCanvasIntersectionPoint(cameraPos, triangles[i].vertices[2], focalLength, scaleFactor, cameraOrientation);
-		drawStrokedTriangle(window, CanvasTriangle(pos0, pos1, pos2), triangles[i].colour);
+	PROFILE_SCOPE("draw lines");
+	for (int i = 0; i < mesh.triangleCount(); i++) {
+		const uint32_t* corners = &mesh.indices[3 * i];
+		drawStrokedTriangle(window, CanvasTriangle(projected[corners[0]], projected[corners[1]], projected[corners[2]]), mesh.colour(i, scene.materials));
 	}
 }
\ No newline at end of file